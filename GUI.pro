@@ -1,4 +1,4 @@
-QT += core gui widgets printsupport
+QT += core gui widgets printsupport concurrent
 
 INCLUDEPATH += .
 DEPENDPATH += .
@@ -15,7 +15,22 @@ HEADERS += \
     device.hpp \
     observable.hpp \
     graph_data.hpp \
-    main_window.hpp
+    decimation.hpp \
+    event_index.hpp \
+    frame_graph.hpp \
+    range_index.hpp \
+    render_thread.hpp \
+    main_window.hpp \
+    playback.hpp \
+    plot_widget.hpp \
+    tile_raster.hpp \
+    prefetch.hpp \
+    quality_governor.hpp \
+    lod_pyramid.hpp \
+    contour.hpp \
+    density_graph.hpp \
+    minimap.hpp \
+    scrollbar_preview.hpp
 
 QMAKE_CXXFLAGS = -std=c++14 -march=native
 QMAKE_CXXFLAGS_RELEASE = -O3
@@ -0,0 +1,349 @@
+#ifndef CONTOUR_HPP
+#define CONTOUR_HPP
+
+#include <QCache>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QPair>
+#include <QPolygonF>
+#include <QRectF>
+#include <QSet>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <numeric>
+
+#include "qcustomplot.hpp"
+
+// iso-lines of frames[m][j] at (t[m], x[j]) as (t, x) polylines, contoured in parallel bands of timesteps
+class marching_squares {
+public:
+    static constexpr int max_rows = 16384;
+
+    inline static QVector<QPolygonF> extract(const QVector<double> & t, const QVector<double> & x, const QVector<QVector<double>> & frames, double level,
+                                             const std::atomic<bool> * cancel = nullptr);
+    inline static QVector<double> crossings(const QVector<double> & x, const QVector<double> & frame, double level); // of one timestep
+
+private:
+    inline static QVector<QPolygonF> band(const QVector<double> & t, const QVector<double> & x, const QVector<QVector<double>> & frames,
+                                          const QVector<int> & rows, int r0, int r1, double level);
+};
+
+QVector<QPolygonF> marching_squares::extract(const QVector<double> & t, const QVector<double> & x, const QVector<QVector<double>> & frames, double level,
+                                             const std::atomic<bool> * cancel) {
+    QVector<int> rows; // the timesteps that are contoured
+    int stride = std::max(1, (frames.size() + max_rows - 1) / max_rows);
+    for (int m = 0; m < frames.size(); m += stride) {
+        rows.push_back(m);
+    }
+    if ((rows.size() < 2) || (x.size() < 2)) {
+        return QVector<QPolygonF>();
+    }
+
+    int n_bands = std::min(rows.size() - 1, 4 * QThread::idealThreadCount());
+    QVector<int> firsts; // every band has the rows firsts[b] ... firsts[b + 1] (the cells in between)
+    for (int b = 0; b <= n_bands; ++b) {
+        firsts.push_back(b * (rows.size() - 1) / n_bands);
+    }
+    QVector<QVector<QPolygonF>> parts(n_bands);
+    QVector<int> indices(n_bands);
+    std::iota(indices.begin(), indices.end(), 0);
+    QtConcurrent::blockingMap(indices, [&] (int & b) {
+        if (!cancel || !*cancel) {
+            parts[b] = band(t, x, frames, rows, firsts[b], firsts[b + 1], level);
+        }
+    });
+
+    QVector<QPolygonF> lines;
+    for (const QVector<QPolygonF> & p : parts) {
+        lines += p;
+    }
+    return lines;
+}
+
+// the x of the points where the iso-lines cross one frame, interpolated like the edges of the cells in extract()
+QVector<double> marching_squares::crossings(const QVector<double> & x, const QVector<double> & frame, double level) {
+    QVector<double> c;
+    for (int j = 0; j + 1 < std::min(x.size(), frame.size()); ++j) {
+        double a = frame[j];
+        double b = frame[j + 1];
+        if ((a >= level) != (b >= level) && !std::isnan(a) && !std::isnan(b)) {
+            c.push_back(x[j] + (level - a) / (b - a) * (x[j + 1] - x[j]));
+        }
+    }
+    return c;
+}
+
+// marching squares on the cells between the rows r0 ... r1, followed by joining the segments into polylines
+QVector<QPolygonF> marching_squares::band(const QVector<double> & t, const QVector<double> & x, const QVector<QVector<double>> & frames,
+                                          const QVector<int> & rows, int r0, int r1, double level) {
+    const int n_x = x.size();
+
+    // every crossing is identified by its edge: 2 * (r * n_x + j) for the one from (r, j) to (r, j + 1), plus 1 for the
+    // one from (r, j) to (r + 1, j)
+    QHash<qint64, QPointF> points;
+    QHash<qint64, QPair<qint64, qint64>> neighbours; // -1 if there is none (yet)
+    auto crossing = [&] (int r, int j, bool along_x) -> qint64 {
+        qint64 id = 2 * (qint64(r) * n_x + j) + (along_x ? 0 : 1);
+        if (!points.contains(id)) {
+            const QVector<double> & f0 = frames.at(rows[r]);
+            double a = f0.at(j);
+            double b = along_x ? f0.at(j + 1) : frames.at(rows[r + 1]).at(j);
+            double s = (level - a) / (b - a);
+            double tc = along_x ? t[rows[r]] : t[rows[r]] + s * (t[rows[r + 1]] - t[rows[r]]);
+            double xc = along_x ? x[j] + s * (x[j + 1] - x[j]) : x[j];
+            points.insert(id, QPointF(tc, xc));
+            neighbours.insert(id, { -1, -1 });
+        }
+        return id;
+    };
+    auto connect = [&] (qint64 a, qint64 b) {
+        QPair<qint64, qint64> & na = neighbours[a];
+        (na.first < 0 ? na.first : na.second) = b;
+        QPair<qint64, qint64> & nb = neighbours[b];
+        (nb.first < 0 ? nb.first : nb.second) = a;
+    };
+
+    for (int r = r0; r < r1; ++r) {
+        const QVector<double> & lower = frames.at(rows[r]);
+        const QVector<double> & upper = frames.at(rows[r + 1]);
+        for (int j = 0; j + 1 < n_x; ++j) {
+            // corners counterclockwise, edge e goes from corner e to corner e + 1
+            double v[4] = { lower.at(j), lower.at(j + 1), upper.at(j + 1), upper.at(j) };
+            if (std::isnan(v[0]) || std::isnan(v[1]) || std::isnan(v[2]) || std::isnan(v[3])) {
+                continue;
+            }
+            int high = (v[0] >= level) | ((v[1] >= level) << 1) | ((v[2] >= level) << 2) | ((v[3] >= level) << 3);
+            if ((high == 0) || (high == 15)) {
+                continue;
+            }
+            auto edge = [&] (int e) {
+                switch (e) {
+                case 0: return crossing(r, j, true);
+                case 1: return crossing(r, j + 1, false);
+                case 2: return crossing(r + 1, j, true);
+                default: return crossing(r, j, false);
+                }
+            };
+
+            if ((high == 5) || (high == 10)) {
+                // saddle: the center decides which corners are connected
+                bool center = 0.25 * (v[0] + v[1] + v[2] + v[3]) >= level;
+                if ((high == 5) == center) {
+                    connect(edge(0), edge(1));
+                    connect(edge(2), edge(3));
+                } else {
+                    connect(edge(3), edge(0));
+                    connect(edge(1), edge(2));
+                }
+                continue;
+            }
+            int crossed[2];
+            int n = 0;
+            for (int e = 0; e < 4; ++e) {
+                if (((high >> e) & 1) != ((high >> ((e + 1) % 4)) & 1)) {
+                    crossed[n++] = e;
+                }
+            }
+            connect(edge(crossed[0]), edge(crossed[1]));
+        }
+    }
+
+    // open lines start at crossings with one neighbour, what is left are closed loops
+    QVector<QPolygonF> lines;
+    QSet<qint64> visited;
+    auto walk = [&] (qint64 start) {
+        QPolygonF line;
+        qint64 previous = -1;
+        qint64 current = start;
+        while ((current >= 0) && !visited.contains(current)) {
+            visited.insert(current);
+            line << points[current];
+            const QPair<qint64, qint64> & n = neighbours[current];
+            qint64 next = (n.first != previous) ? n.first : n.second;
+            previous = current;
+            current = next;
+        }
+        if ((current >= 0) && (current == start)) {
+            line << points[start]; // closed
+        }
+        lines.push_back(line);
+    };
+    for (auto it = neighbours.begin(); it != neighbours.end(); ++it) {
+        if (((it.value().first < 0) || (it.value().second < 0)) && !visited.contains(it.key())) {
+            walk(it.key());
+        }
+    }
+    for (auto it = neighbours.begin(); it != neighbours.end(); ++it) {
+        if (!visited.contains(it.key())) {
+            walk(it.key());
+        }
+    }
+    return lines;
+}
+
+// iso-lines of one series per level (up to max_points), extracted in the background; extracted() when one is done
+class contour_cache : public QObject {
+    Q_OBJECT
+
+public:
+    inline contour_cache(const QVector<double> & t, const QVector<double> & x, const QVector<QVector<double>> & frames, QObject * parent = nullptr);
+    inline ~contour_cache();
+
+    inline bool get(double level, QVector<QPolygonF> & lines);
+
+    static constexpr int max_points = 1 << 22;
+
+signals:
+    void extracted();
+
+private:
+    QVector<double> t;
+    QVector<double> x;
+    QVector<QVector<double>> frames;
+    QMap<double, std::shared_ptr<QFutureWatcher<QVector<QPolygonF>>>> pending;
+    QCache<double, QVector<QPolygonF>> levels; // the cost of a level is its number of points
+    std::shared_ptr<std::atomic<bool>> cancel;
+};
+
+contour_cache::contour_cache(const QVector<double> & t, const QVector<double> & x, const QVector<QVector<double>> & frames, QObject * parent)
+    : QObject(parent), t(t), x(x), frames(frames), levels(max_points), cancel(new std::atomic<bool>(false)) {
+}
+
+contour_cache::~contour_cache() {
+    *cancel = true;
+    for (auto & w : pending) {
+        w->cancel(); // if it has not started yet
+    }
+}
+
+// the lines of level, if they are extracted already (starts the extraction otherwise)
+bool contour_cache::get(double level, QVector<QPolygonF> & lines) {
+    if (QVector<QPolygonF> * cached = levels.object(level)) {
+        lines = *cached;
+        return true;
+    }
+    auto it = pending.find(level);
+    if (it == pending.end()) {
+        std::shared_ptr<QFutureWatcher<QVector<QPolygonF>>> w(new QFutureWatcher<QVector<QPolygonF>>);
+        QObject::connect(w.get(), SIGNAL(finished()), this, SIGNAL(extracted()));
+        QVector<double> t_ = t;
+        QVector<double> x_ = x;
+        QVector<QVector<double>> frames_ = frames;
+        std::shared_ptr<std::atomic<bool>> c = cancel;
+        w->setFuture(QtConcurrent::run([t_, x_, frames_, level, c] () {
+            return marching_squares::extract(t_, x_, frames_, level, c.get());
+        }));
+        pending.insert(level, w);
+        return false;
+    }
+    if (!it.value()->isFinished()) {
+        return false;
+    }
+    lines = it.value()->result();
+    pending.erase(it);
+    int points = 0;
+    for (const QPolygonF & l : lines) {
+        points += l.size();
+    }
+    levels.insert(level, new QVector<QPolygonF>(lines), std::max(points, 1)); // takes ownership (deletes it if it is too large)
+    return true;
+}
+
+// contour_graph draws polylines given in plot coordinates, e.g. the iso-lines of contour_cache.
+class contour_graph : public QCPAbstractPlottable {
+public:
+    inline contour_graph(QCPAxis * key_axis, QCPAxis * value_axis);
+
+    inline void set_lines(const QVector<QPolygonF> & lines);
+
+    inline void clearData() override;
+    inline double selectTest(const QPointF & pos, bool onlySelectable, QVariant * details = 0) const override;
+
+protected:
+    inline void draw(QCPPainter * painter) override;
+    inline void drawLegendIcon(QCPPainter * painter, const QRectF & rect) const override;
+    inline QCPRange getKeyRange(bool & foundRange, SignDomain inSignDomain = sdBoth) const override;
+    inline QCPRange getValueRange(bool & foundRange, SignDomain inSignDomain = sdBoth) const override;
+
+private:
+    QVector<QPolygonF> lines;
+    QVector<QRectF> bounds; // of every line, for culling
+    QRectF all;
+};
+
+contour_graph::contour_graph(QCPAxis * key_axis, QCPAxis * value_axis)
+    : QCPAbstractPlottable(key_axis, value_axis) {
+}
+
+void contour_graph::set_lines(const QVector<QPolygonF> & lines_) {
+    lines = lines_;
+    bounds.clear();
+    all = QRectF();
+    for (const QPolygonF & l : lines) {
+        bounds.push_back(l.boundingRect());
+        all = all.isNull() ? bounds.back() : all.united(bounds.back());
+    }
+}
+
+void contour_graph::clearData() {
+    set_lines(QVector<QPolygonF>());
+}
+
+double contour_graph::selectTest(const QPointF & pos, bool onlySelectable, QVariant * details) const {
+    Q_UNUSED(pos);
+    Q_UNUSED(onlySelectable);
+    Q_UNUSED(details);
+    return -1; // not selectable
+}
+
+void contour_graph::draw(QCPPainter * painter) {
+    if (!mKeyAxis || !mValueAxis || (mainPen().style() == Qt::NoPen)) {
+        return;
+    }
+    QCPRange k = mKeyAxis->range();
+    QCPRange v = mValueAxis->range();
+    QRectF visible(k.lower, v.lower, k.size(), v.size());
+
+    applyDefaultAntialiasingHint(painter);
+    painter->setPen(mainPen());
+    painter->setBrush(Qt::NoBrush);
+    QPolygonF pixels;
+    for (int i = 0; i < lines.size(); ++i) {
+        const QRectF & b = bounds[i];
+        if ((b.right() < visible.left()) || (b.left() > visible.right()) || (b.bottom() < visible.top()) || (b.top() > visible.bottom())) {
+            continue; // (not intersects(), which misses lines along t or x)
+        }
+        pixels.resize(lines[i].size());
+        for (int p = 0; p < lines[i].size(); ++p) {
+            pixels[p] = coordsToPixels(lines[i][p].x(), lines[i][p].y());
+        }
+        painter->drawPolyline(pixels);
+    }
+}
+
+void contour_graph::drawLegendIcon(QCPPainter * painter, const QRectF & rect) const {
+    painter->setPen(mainPen());
+    painter->drawLine(QLineF(rect.left(), rect.center().y(), rect.right(), rect.center().y()));
+}
+
+QCPRange contour_graph::getKeyRange(bool & foundRange, SignDomain inSignDomain) const {
+    Q_UNUSED(inSignDomain);
+    foundRange = !lines.isEmpty();
+    return QCPRange(all.left(), all.right());
+}
+
+QCPRange contour_graph::getValueRange(bool & foundRange, SignDomain inSignDomain) const {
+    Q_UNUSED(inSignDomain);
+    foundRange = !lines.isEmpty();
+    return QCPRange(all.top(), all.bottom());
+}
+
+#endif
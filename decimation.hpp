@@ -0,0 +1,121 @@
+#ifndef DECIMATION_HPP
+#define DECIMATION_HPP
+
+#include <QVector>
+#include <algorithm>
+#include <cmath>
+
+#include "qcustomplot.hpp"
+
+// Largest-Triangle-Three-Buckets downsampling, returns the indices of the kept points
+inline QVector<int> lttb(const QVector<double> & keys, const QVector<double> & values, int n_out) {
+    int n = keys.size();
+    QVector<int> kept;
+    if ((n_out >= n) || (n_out < 3)) {
+        kept.resize(n);
+        for (int i = 0; i < n; ++i) {
+            kept[i] = i;
+        }
+        return kept;
+    }
+    kept.reserve(n_out);
+
+    double every = double(n - 2) / (n_out - 2);
+    int a = 0;
+    kept.push_back(a);
+
+    for (int b = 0; b < n_out - 2; ++b) {
+        // average of the next bucket
+        int avg_begin = int(std::floor((b + 1) * every)) + 1;
+        int avg_end = std::min(int(std::floor((b + 2) * every)) + 1, n);
+        double avg_x = 0;
+        double avg_y = 0;
+        for (int i = avg_begin; i < avg_end; ++i) {
+            avg_x += keys[i];
+            avg_y += values[i];
+        }
+        avg_x /= (avg_end - avg_begin);
+        avg_y /= (avg_end - avg_begin);
+
+        // point of the current bucket with the largest triangle
+        int begin = int(std::floor(b * every)) + 1;
+        int end = int(std::floor((b + 1) * every)) + 1;
+        double max_area = -1;
+        int next = begin;
+        for (int i = begin; i < end; ++i) {
+            double area = std::abs((keys[a] - avg_x) * (values[i] - values[a]) - (keys[a] - keys[i]) * (avg_y - values[a]));
+            if (area > max_area) {
+                max_area = area;
+                next = i;
+            }
+        }
+
+        kept.push_back(next);
+        a = next;
+    }
+
+    kept.push_back(n - 1);
+    return kept;
+}
+
+// LTTB-reduced copies of a time trace, each level 4 times smaller; select() takes the coarsest with 2 points per pixel
+class decimation {
+public:
+    inline decimation();
+    inline decimation(const QVector<double> & keys, const QVector<double> & values);
+
+    inline int levels() const;
+    inline void select(const QCPRange & visible, int pixels, QVector<double> & keys, QVector<double> & values) const;
+
+private:
+    static constexpr int factor = 4;
+    static constexpr int min_points = 1024;
+
+    QVector<QVector<double>> level_keys; // level 0 is the full-resolution data
+    QVector<QVector<double>> level_values;
+};
+
+decimation::decimation() {
+}
+
+decimation::decimation(const QVector<double> & keys, const QVector<double> & values) {
+    level_keys.push_back(keys);
+    level_values.push_back(values);
+
+    // every level is reduced from the full-resolution data, not from the level below
+    for (int n = keys.size() / factor; n >= min_points; n /= factor) {
+        QVector<int> kept = lttb(keys, values, n);
+        QVector<double> k(kept.size());
+        QVector<double> v(kept.size());
+        for (int i = 0; i < kept.size(); ++i) {
+            k[i] = keys[kept[i]];
+            v[i] = values[kept[i]];
+        }
+        level_keys.push_back(k);
+        level_values.push_back(v);
+    }
+}
+
+int decimation::levels() const {
+    return level_keys.size();
+}
+
+void decimation::select(const QCPRange & visible, int pixels, QVector<double> & keys, QVector<double> & values) const {
+    int needed = std::max(2 * pixels, 2);
+
+    for (int l = level_keys.size() - 1; l >= 0; --l) {
+        const QVector<double> & k = level_keys[l];
+
+        // one point beyond the visible range on each side, so that the line leaves the axis rect correctly
+        int i0 = std::max(int(std::lower_bound(k.begin(), k.end(), visible.lower) - k.begin()) - 1, 0);
+        int i1 = std::min(int(std::upper_bound(k.begin(), k.end(), visible.upper) - k.begin()), k.size() - 1);
+
+        if ((i1 - i0 + 1 >= needed) || (l == 0)) {
+            keys = k.mid(i0, i1 - i0 + 1);
+            values = level_values[l].mid(i0, i1 - i0 + 1);
+            return;
+        }
+    }
+}
+
+#endif
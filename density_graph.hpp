@@ -0,0 +1,185 @@
+#ifndef DENSITY_GRAPH_HPP
+#define DENSITY_GRAPH_HPP
+
+#include <QColor>
+#include <QImage>
+#include <QPolygonF>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "frame_graph.hpp"
+#include "qcustomplot.hpp"
+
+// the timesteps of a time window overlaid as a persistence image (alpha grows with the log of the frames per pixel)
+class density_graph : public QCPGraph {
+public:
+    inline density_graph(QCPAxis * key_axis, QCPAxis * value_axis);
+
+    inline void set_frames(const QVector<double> & keys, const QVector<QVector<double>> & frames, int begin, int end, bool log_values = false);
+    inline void set_budget(int frames);
+
+protected:
+    inline void draw(QCPPainter * painter) override;
+
+private:
+    QVector<double> keys;
+    QVector<QVector<double>> frames;
+    int begin;
+    int end;
+    int budget;
+    bool log_values;
+    pixel_transform transform; // the image was made with
+    QImage image;
+    bool valid;
+
+    inline void accumulate(const pixel_transform & current, const QRect & rect);
+};
+
+density_graph::density_graph(QCPAxis * key_axis, QCPAxis * value_axis)
+    : QCPGraph(key_axis, value_axis), begin(0), end(-1), budget(4096), log_values(false), valid(false) {
+}
+
+// the timesteps begin ... end of frames
+void density_graph::set_frames(const QVector<double> & keys_, const QVector<QVector<double>> & frames_, int begin_, int end_, bool log_values_) {
+    keys = keys_;
+    frames = frames_;
+    begin = std::max(0, begin_);
+    end = std::min(end_, frames.size() - 1);
+    log_values = log_values_;
+    valid = false;
+}
+
+void density_graph::set_budget(int frames_) {
+    if (frames_ != budget) {
+        budget = std::max(1, frames_);
+        valid = false;
+    }
+}
+
+void density_graph::draw(QCPPainter * painter) {
+    if (!mKeyAxis || !mValueAxis || (begin > end)) {
+        return;
+    }
+    QRect rect = mKeyAxis->axisRect()->rect();
+    pixel_transform current(mKeyAxis.data(), mValueAxis.data());
+    if (!valid || !(transform == current) || (image.size() != rect.size())) {
+        accumulate(current, rect);
+    }
+    painter->drawImage(rect.topLeft(), image);
+}
+
+void density_graph::accumulate(const pixel_transform & current, const QRect & rect) {
+    transform = current;
+    valid = true;
+    const int w = rect.width();
+    const int h = rect.height();
+    image = QImage(std::max(w, 1), std::max(h, 1), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    if ((w <= 0) || (h <= 0)) {
+        return;
+    }
+
+    int stride = std::max(1, (end - begin + budget) / budget);
+    int n = (end - begin) / stride + 1;
+    int n_tiles = std::min(w, 4 * QThread::idealThreadCount());
+    QVector<quint32> counts(w * h, 0); // the tiles write disjoint columns
+    QVector<pixel_transform> tiles(n_tiles, current); // culled to the keys of the tile's columns
+    QVector<int> firsts; // every tile has the columns firsts[c] ... firsts[c + 1] - 1
+    for (int c = 0; c <= n_tiles; ++c) {
+        firsts.push_back(c * w / n_tiles);
+    }
+    for (int c = 0; c < n_tiles; ++c) {
+        double a = mKeyAxis->pixelToCoord(rect.left() + firsts[c]);
+        double b = mKeyAxis->pixelToCoord(rect.left() + firsts[c + 1]);
+        tiles[c].key_lower = std::min(a, b);
+        tiles[c].key_upper = std::max(a, b);
+    }
+    QVector<int> indices(n_tiles);
+    std::iota(indices.begin(), indices.end(), 0);
+    quint32 * hits = counts.data(); // detached here, not on the workers
+
+    QtConcurrent::blockingMap(indices, [&] (int & c) {
+        const int c0 = firsts[c];
+        const int c1 = firsts[c + 1] - 1;
+        const int tile_w = c1 - c0 + 1;
+        QVector<int> last(tile_w * h, -1); // the frame that hit a pixel last, so that each frame counts once
+        int * stamp = last.data();
+        auto hit = [&] (int row, int col, int f) {
+            int i = row * tile_w + col - c0;
+            if (stamp[i] != f) {
+                stamp[i] = f;
+                ++hits[row * w + col];
+            }
+        };
+
+        for (int f = 0; f < n; ++f) {
+            QPolygonF line = tiles[c].project(keys, frames.at(begin + f * stride), log_values);
+
+            // a single point (one key, or the only one projected for the tile) gets its pixel
+            if (line.size() == 1) {
+                int col = int(std::floor(line[0].x() - rect.left()));
+                int row = int(std::floor(line[0].y() - rect.top()));
+                if ((col >= c0) && (col <= c1) && (row >= 0) && (row < h)) {
+                    hit(row, col, f);
+                }
+                continue;
+            }
+
+            // every pixel column between two points gets the rows between the line's heights at its edges
+            for (int p = 0; p + 1 < line.size(); ++p) {
+                double x0 = line[p].x() - rect.left();
+                double y0 = line[p].y() - rect.top();
+                double x1 = line[p + 1].x() - rect.left();
+                double y1 = line[p + 1].y() - rect.top();
+                if (x1 < x0) {
+                    std::swap(x0, x1);
+                    std::swap(y0, y1);
+                }
+                int col0 = std::max(c0, int(std::floor(x0)));
+                int col1 = std::min(c1, int(std::floor(x1)));
+                double slope = (x1 > x0) ? (y1 - y0) / (x1 - x0) : 0;
+                for (int col = col0; col <= col1; ++col) {
+                    double ya = y0 + slope * (std::max(double(col), x0) - x0);
+                    double yb = y0 + slope * (std::min(double(col + 1), x1) - x0);
+                    if (x1 == x0) {
+                        ya = y0;
+                        yb = y1;
+                    }
+                    int r0 = std::max(0, int(std::floor(std::min(ya, yb))));
+                    int r1 = std::min(h - 1, int(std::floor(std::max(ya, yb))));
+                    for (int row = r0; row <= r1; ++row) {
+                        hit(row, col, f);
+                    }
+                }
+            }
+        }
+    });
+
+    const quint32 * total = counts.constData();
+    quint32 most = *std::max_element(total, total + w * h);
+    if (most == 0) {
+        return;
+    }
+
+    // color ramp: the pen color with an alpha of 0.15 + 0.85 * log(1 + count) / log(1 + most), opaque for the most
+    // frames and approaching 0.15 for a single one as the most grows
+    QColor color = mainPen().color();
+    double norm = 1.0 / std::log1p(double(most));
+    for (int row = 0; row < h; ++row) {
+        QRgb * pixels = reinterpret_cast<QRgb *>(image.scanLine(row));
+        for (int col = 0; col < w; ++col) {
+            quint32 k = total[row * w + col];
+            if (k > 0) {
+                double a = 0.15 + 0.85 * std::log1p(double(k)) * norm;
+                int alpha = int(255 * a);
+                pixels[col] = qRgba(color.red() * alpha / 255, color.green() * alpha / 255, color.blue() * alpha / 255, alpha);
+            }
+        }
+    }
+}
+
+#endif
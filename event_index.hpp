@@ -0,0 +1,136 @@
+#ifndef EVENT_INDEX_HPP
+#define EVENT_INDEX_HPP
+
+#include <QString>
+#include <QVector>
+#include <algorithm>
+#include <cmath>
+
+// An event is a timestep worth jumping to in a time trace: where it crosses its mid-level (e.g. I_d switching),
+// where it turns (local extrema) or where it changes fastest (steep-slope regions, e.g. V_g steps).
+
+class trace_event {
+public:
+    enum kind_t {
+        crossing,
+        maximum,
+        minimum,
+        slope
+    };
+
+    kind_t kind;
+    int index;      // timestep
+    int observable; // index into main_window::observables
+    int series;     // index into tobservable::data
+
+    inline QString name() const;
+};
+
+QString trace_event::name() const {
+    switch (kind) {
+    case crossing:
+        return "crossing";
+    case maximum:
+        return "maximum";
+    case minimum:
+        return "minimum";
+    default:
+        return "steep slope";
+    }
+}
+
+// Scans one trace. All thresholds are relative to the range of the trace, hysteresis keeps noise from producing
+// bursts of events.
+inline QVector<trace_event> find_events(const QVector<double> & t, const QVector<double> & data, int observable, int series) {
+    static constexpr double crossing_hysteresis = 0.05; // of the range, around the mid-level
+    static constexpr double extremum_hysteresis = 0.10; // of the range, needed to confirm a turn
+    static constexpr double slope_threshold     = 0.25; // of the steepest slope
+
+    QVector<trace_event> events;
+    int n = std::min(t.size(), data.size());
+    if (n < 3) {
+        return events;
+    }
+
+    auto minmax = std::minmax_element(data.begin(), data.begin() + n);
+    double min = *minmax.first;
+    double max = *minmax.second;
+    double range = max - min;
+    if (!(range > 0)) {
+        return events;
+    }
+
+    auto add = [&] (trace_event::kind_t kind, int index) {
+        events.push_back({ kind, index, observable, series });
+    };
+
+    // mid-level crossings: the side only changes after leaving the hysteresis band
+    double mid = 0.5 * (min + max);
+    double band = crossing_hysteresis * range;
+    int side = (data[0] > mid) ? 1 : -1;
+    int last_cross = 0;
+    for (int m = 1; m < n; ++m) {
+        if ((data[m - 1] - mid) * (data[m] - mid) <= 0) {
+            last_cross = m;
+        }
+        if ((side < 0) && (data[m] > mid + band)) {
+            side = 1;
+            add(trace_event::crossing, last_cross);
+        } else if ((side > 0) && (data[m] < mid - band)) {
+            side = -1;
+            add(trace_event::crossing, last_cross);
+        }
+    }
+
+    // local extrema by zig-zag: a candidate is confirmed once the trace has moved back by the hysteresis
+    double turn = extremum_hysteresis * range;
+    int candidate = 0;
+    int direction = 0; // +1 looking for a maximum, -1 looking for a minimum
+    for (int m = 1; m < n; ++m) {
+        if (direction >= 0 && data[m] > data[candidate]) {
+            candidate = m;
+            direction = 1;
+        } else if (direction <= 0 && data[m] < data[candidate]) {
+            candidate = m;
+            direction = -1;
+        } else if ((direction > 0) && (data[candidate] - data[m] > turn)) {
+            add(trace_event::maximum, candidate);
+            candidate = m;
+            direction = -1;
+        } else if ((direction < 0) && (data[m] - data[candidate] > turn)) {
+            add(trace_event::minimum, candidate);
+            candidate = m;
+            direction = 1;
+        }
+    }
+
+    // steep-slope regions: one event at the steepest point of every region above the threshold
+    QVector<double> slope(n - 1);
+    double steepest = 0;
+    for (int m = 0; m < n - 1; ++m) {
+        double dt = t[m + 1] - t[m];
+        slope[m] = (dt > 0) ? std::abs(data[m + 1] - data[m]) / dt : 0;
+        steepest = std::max(steepest, slope[m]);
+    }
+    int peak = -1;
+    for (int m = 0; m < n - 1; ++m) {
+        if (slope[m] >= slope_threshold * steepest) {
+            if ((peak < 0) || (slope[m] > slope[peak])) {
+                peak = m;
+            }
+        } else if (peak >= 0) {
+            add(trace_event::slope, peak);
+            peak = -1;
+        }
+    }
+    if (peak >= 0) {
+        add(trace_event::slope, peak);
+    }
+
+    std::sort(events.begin(), events.end(), [] (const trace_event & a, const trace_event & b) {
+        return a.index < b.index;
+    });
+    return events;
+}
+
+#endif
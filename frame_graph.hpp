@@ -0,0 +1,299 @@
+#ifndef FRAME_GRAPH_HPP
+#define FRAME_GRAPH_HPP
+
+#include <QImage>
+#include <QLineF>
+#include <QPolygonF>
+#include <QTransform>
+#include <QVector>
+#include <algorithm>
+#include <cmath>
+
+#include "qcustomplot.hpp"
+#include "render_thread.hpp"
+#include "tile_raster.hpp"
+
+// QCPAxis::coordToPixel as pixel = a * coord + b (or a * log(coord / ref) + b), fitted at the ends of the range, for
+// worker threads and to tell whether pixel data is still valid
+class axis_map {
+public:
+    double a = 0;
+    double b = 0;
+    double ref = 1;
+    double log_ref = 0; // log(ref) for positive ranges
+    bool log = false;
+    double invalid = 0; // where QCustomPlot puts coordinates that are invalid on a logarithmic axis
+
+    inline axis_map();
+    inline axis_map(const QCPAxis * axis);
+
+    inline double map(double coord) const;
+    inline double map_log10(double log_coord) const;
+    inline bool operator==(const axis_map & other) const;
+};
+
+axis_map::axis_map() {
+}
+
+axis_map::axis_map(const QCPAxis * axis) {
+    QCPRange r = axis->range();
+    double lower = axis->coordToPixel(r.lower);
+    double upper = axis->coordToPixel(r.upper);
+
+    log = axis->scaleType() == QCPAxis::stLogarithmic;
+    if (log) {
+        ref = r.lower;
+        log_ref = (ref > 0) ? std::log(ref) : 0;
+        a = (upper - lower) / std::log(r.upper / r.lower);
+        b = lower;
+        invalid = axis->coordToPixel((r.upper > 0) ? 0 : 1); // a coordinate of the wrong sign
+    } else {
+        a = (upper - lower) / r.size();
+        b = lower - a * r.lower;
+    }
+}
+
+double axis_map::map(double coord) const {
+    if (log) {
+        double ratio = coord / ref;
+        return (ratio > 0) ? a * std::log(ratio) + b : invalid;
+    }
+    return a * coord + b;
+}
+
+double axis_map::map_log10(double log_coord) const {
+    static const double ln10 = std::log(10.0);
+    if (log) {
+        return (ref > 0) ? a * (log_coord * ln10 - log_ref) + b : invalid;
+    }
+    return a * std::pow(10.0, log_coord) + b;
+}
+
+bool axis_map::operator==(const axis_map & other) const {
+    return (a == other.a) && (b == other.b) && (ref == other.ref) && (log == other.log);
+}
+
+// pixel_transform maps (key, value) pairs of a graph with a horizontal key axis to pixels.
+class pixel_transform {
+public:
+    axis_map key;
+    axis_map value;
+    double key_lower = 0; // visible key range, for culling
+    double key_upper = 0;
+    int left = 0;         // axis rect columns, for per-pixel decimation
+    int right = 0;
+
+    inline pixel_transform();
+    inline pixel_transform(const QCPAxis * key_axis, const QCPAxis * value_axis);
+
+    inline QPolygonF project(const QVector<double> & keys, const QVector<double> & values, bool log_values = false) const;
+    inline bool operator==(const pixel_transform & other) const;
+};
+
+pixel_transform::pixel_transform() {
+}
+
+pixel_transform::pixel_transform(const QCPAxis * key_axis, const QCPAxis * value_axis)
+    : key(key_axis), value(value_axis), key_lower(key_axis->range().lower), key_upper(key_axis->range().upper),
+      left(key_axis->axisRect()->left()), right(key_axis->axisRect()->right()) {
+}
+
+// the visible keys (plus one point on each side) in pixels, reduced to first/min/max/last per pixel column
+QPolygonF pixel_transform::project(const QVector<double> & keys, const QVector<double> & values, bool log_values) const {
+    auto map_value = [this, log_values] (double v) {
+        return log_values ? value.map_log10(v) : value.map(v);
+    };
+
+    int n = std::min(keys.size(), values.size());
+    int i0 = std::max(int(std::lower_bound(keys.begin(), keys.begin() + n, key_lower) - keys.begin()) - 1, 0);
+    int i1 = std::min(int(std::upper_bound(keys.begin(), keys.begin() + n, key_upper) - keys.begin()), n - 1);
+
+    QPolygonF polyline;
+    if (i0 > i1) {
+        return polyline;
+    }
+    polyline.reserve(std::min(i1 - i0 + 1, 4 * (right - left + 3)));
+
+    int i = i0;
+    while (i <= i1) {
+        double px = key.map(keys[i]);
+        int column = int(std::floor(px));
+
+        double first = map_value(values[i]);
+        double lo = first;
+        double hi = first;
+        double last = first;
+        int count = 1;
+        while ((i + count <= i1) && (int(std::floor(key.map(keys[i + count]))) == column)) {
+            last = map_value(values[i + count]);
+            lo = std::min(lo, last);
+            hi = std::max(hi, last);
+            ++count;
+        }
+
+        polyline << QPointF(px, first);
+        if (count > 2) {
+            polyline << QPointF(px, lo) << QPointF(px, hi);
+        }
+        if (count > 1) {
+            polyline << QPointF(key.map(keys[i + count - 1]), last);
+        }
+        i += count;
+    }
+    return polyline;
+}
+
+bool pixel_transform::operator==(const pixel_transform & other) const {
+    return (key == other.key) && (value == other.value);
+}
+
+// one timestep of a spatial profile, drawn as a pixel polyline (possibly prepared on a worker thread or rasterized on
+// the render thread); the QCPGraph data stays empty, ranges and selection come from the frame
+class frame_graph : public QCPGraph {
+public:
+    inline frame_graph(QCPAxis * key_axis, QCPAxis * value_axis);
+
+    inline void set_frame(const QVector<double> & keys, const QVector<double> & values, bool log_values = false);
+    inline void set_polyline(const pixel_transform & transform, const QPolygonF & polyline);
+
+    inline double selectTest(const QPointF & pos, bool onlySelectable, QVariant * details = 0) const override;
+
+protected:
+    inline void draw(QCPPainter * painter) override;
+    inline void draw_tiled(QCPPainter * painter);
+    inline QCPRange getKeyRange(bool & foundRange, SignDomain inSignDomain = sdBoth) const override;
+    inline QCPRange getValueRange(bool & foundRange, SignDomain inSignDomain = sdBoth) const override;
+
+private:
+    inline static QCPRange range(const QVector<double> & coords, bool log, bool & foundRange, SignDomain inSignDomain);
+
+private:
+    QVector<double> keys;
+    QVector<double> values;
+    bool log_values; // values are log10 of the coordinates
+    pixel_transform transform;
+    QPolygonF polyline;
+    bool valid;
+};
+
+frame_graph::frame_graph(QCPAxis * key_axis, QCPAxis * value_axis)
+    : QCPGraph(key_axis, value_axis), log_values(false), valid(false) {
+}
+
+void frame_graph::set_frame(const QVector<double> & keys_, const QVector<double> & values_, bool log_values_) {
+    keys = keys_;
+    values = values_;
+    log_values = log_values_;
+    valid = false;
+}
+
+void frame_graph::set_polyline(const pixel_transform & transform_, const QPolygonF & polyline_) {
+    transform = transform_;
+    polyline = polyline_;
+    valid = true;
+}
+
+// the pixel distance to the polyline of the current axes
+double frame_graph::selectTest(const QPointF & pos, bool onlySelectable, QVariant * details) const {
+    Q_UNUSED(details);
+    if ((onlySelectable && !mSelectable) || !mKeyAxis || !mValueAxis || keys.isEmpty()) {
+        return -1;
+    }
+    if (!mKeyAxis->axisRect()->rect().contains(pos.toPoint())) {
+        return -1;
+    }
+    pixel_transform current(mKeyAxis.data(), mValueAxis.data());
+    QPolygonF line = (valid && (transform == current)) ? polyline : current.project(keys, values, log_values);
+    if (line.isEmpty()) {
+        return -1;
+    }
+    double best = QLineF(line[0], pos).length();
+    for (int i = 0; i + 1 < line.size(); ++i) {
+        best = std::min(best, std::sqrt(distSqrToLine(line[i], line[i + 1], pos)));
+    }
+    return best;
+}
+
+void frame_graph::draw(QCPPainter * painter) {
+    if (!mKeyAxis || !mValueAxis || (mainPen().style() == Qt::NoPen)) {
+        return;
+    }
+
+    pixel_transform current(mKeyAxis.data(), mValueAxis.data());
+    if (!valid || !(transform == current)) {
+        set_polyline(current, current.project(keys, values, log_values));
+    }
+
+    applyDefaultAntialiasingHint(painter);
+    bool exporting = painter->modes() & QCPPainter::pmNoCaching;
+    bool vectorized = painter->modes() & QCPPainter::pmVectorized;
+    raster_layer * raster = raster_layer::find(mParentPlot);
+    if (raster && !exporting && !vectorized) {
+        raster->add(polyline, mainPen(), clipRect(), painter->testRenderHint(QPainter::Antialiasing));
+        return;
+    }
+    if (exporting && !vectorized) {
+        draw_tiled(painter);
+        return;
+    }
+
+    painter->setPen(mainPen());
+    painter->setBrush(Qt::NoBrush);
+    painter->drawPolyline(polyline);
+}
+
+// raster exports may be scaled far beyond the screen, so the polyline is rasterized in parallel tiles
+void frame_graph::draw_tiled(QCPPainter * painter) {
+    QTransform to_device = painter->transform();
+    double scale = std::sqrt(std::abs(to_device.determinant()));
+
+    raster_job job;
+    job.antialiased = painter->testRenderHint(QPainter::Antialiasing);
+    QPen pen = mainPen();
+    if (!pen.isCosmetic() || (painter->modes() & QCPPainter::pmNonCosmetic)) {
+        pen.setWidthF(std::max(pen.widthF(), 1.0) * scale);
+        pen.setCosmetic(false);
+    }
+    QRectF area = clipRect();
+    if (painter->hasClipping()) {
+        area &= painter->clipBoundingRect(); // e.g. only an exposed strip of a pan
+    }
+    job.add(to_device.map(polyline), pen, to_device.mapRect(area).toAlignedRect());
+    if (job.clip.isEmpty()) {
+        return;
+    }
+
+    QImage image(job.clip.size(), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    rasterize(image, job.clip.topLeft(), job);
+
+    painter->save();
+    painter->resetTransform();
+    painter->drawImage(job.clip.topLeft(), image);
+    painter->restore();
+}
+
+QCPRange frame_graph::getKeyRange(bool & foundRange, SignDomain inSignDomain) const {
+    return range(keys, false, foundRange, inSignDomain);
+}
+
+QCPRange frame_graph::getValueRange(bool & foundRange, SignDomain inSignDomain) const {
+    return range(values, log_values, foundRange, inSignDomain);
+}
+
+// of the coordinates (10^coords for log) within the sign domain
+QCPRange frame_graph::range(const QVector<double> & coords, bool log, bool & foundRange, SignDomain inSignDomain) {
+    QCPRange r(+1e300, -1e300);
+    for (double c : coords) {
+        double v = log ? std::pow(10.0, c) : c;
+        if (((inSignDomain == sdNegative) && (v >= 0)) || ((inSignDomain == sdPositive) && (v <= 0))) {
+            continue;
+        }
+        r.lower = std::min(r.lower, v);
+        r.upper = std::max(r.upper, v);
+    }
+    foundRange = r.lower <= r.upper;
+    return foundRange ? r : QCPRange();
+}
+
+#endif
@@ -3,9 +3,14 @@
 
 #include <QVector>
 #include <QString>
+#include <algorithm>
+#include <cmath>
 
 #include <qcustomplot.hpp>
 
+#include "decimation.hpp"
+#include "range_index.hpp"
+
 // Theese are just some POD-classes which are used by the "observable"-class
 
 class graph_data {
@@ -15,20 +20,136 @@ public:
     double max;
 };
 
+// Logarithmic plots show the magnitude of the data, the sign is read from the data itself where values are printed.
+// log10 of the magnitude is computed once and used for ranges and drawing; zeros are put at the smallest non-zero
+// magnitude of the series instead of -inf.
+inline QVector<double> log_magnitude(const QVector<double> & data, double floor) {
+    QVector<double> l(data.size());
+    for (int i = 0; i < data.size(); ++i) {
+        double a = std::abs(data[i]);
+        l[i] = (a > 0) ? std::log10(a) : floor;
+    }
+    return l;
+}
+
+inline double log_floor(const QVector<double> & data, double floor = 0) {
+    double smallest = 0;
+    for (double v : data) {
+        double a = std::abs(v);
+        if ((a > 0) && ((smallest == 0) || (a < smallest))) {
+            smallest = a;
+        }
+    }
+    return (smallest > 0) ? std::log10(smallest) : floor;
+}
+
 class xgraph_data : public graph_data {
 public:
     QVector<QVector<double>> data; // a vector of graph-data (one element per timestep)
+    range_index frames; // min/max of every timestep, queryable over time intervals
+    profile_index envelope; // min/max/mean profiles over time intervals, built on first use
+    QVector<int> run_start; // first timestep of the run of nearly identical frames every timestep belongs to
+    QVector<double> run_deviation; // largest difference of every timestep to the first one of its run
+
+    QVector<QVector<double>> log_data; // log10 of the magnitudes, built by make_log() for logarithmic plots
+    range_index log_frames;
+    profile_index log_envelope;
+    QVector<int> log_run_start;
+    QVector<double> log_run_deviation;
+
+    static constexpr double identical = 1e-4; // largest change (relative to the displayed range) that is not visible
 
     inline xgraph_data() {
     }
     inline xgraph_data(const QString & title, const QVector<QVector<double>> & data_, double min, double max)
         : graph_data{title, min, max}, data(data_) {
+        QVector<double> frame_min(data.size());
+        QVector<double> frame_max(data.size());
+        for (int m = 0; m < data.size(); ++m) {
+            auto minmax = std::minmax_element(data.at(m).begin(), data.at(m).end()); // at() does not detach
+            frame_min[m] = *minmax.first;
+            frame_max[m] = *minmax.second;
+
+            // steady states repeat the same profile many times: share the storage of exactly equal frames
+            if ((m > 0) && (data.at(m) == data.at(m - 1))) {
+                data[m] = data.at(m - 1);
+            }
+        }
+        frames = range_index(frame_min, frame_max);
+        find_runs(data, frame_min, frame_max, run_start, run_deviation);
+    }
+
+    inline void make_log() {
+        if (!log_data.isEmpty() || data.isEmpty()) {
+            return;
+        }
+
+        double floor = 1e300;
+        for (const QVector<double> & frame : data) {
+            floor = std::min(floor, log_floor(frame, 1e300));
+        }
+        if (floor == 1e300) {
+            floor = -30; // all zero
+        }
+
+        log_data = QVector<QVector<double>>(data.size());
+        QVector<double> frame_min(data.size());
+        QVector<double> frame_max(data.size());
+        for (int m = 0; m < data.size(); ++m) {
+            if ((m > 0) && (data.at(m).constData() == data.at(m - 1).constData())) {
+                log_data[m] = log_data[m - 1]; // shared in data, so shared here, too
+            } else {
+                log_data[m] = log_magnitude(data.at(m), floor);
+            }
+            auto minmax = std::minmax_element(log_data.at(m).begin(), log_data.at(m).end());
+            frame_min[m] = *minmax.first;
+            frame_max[m] = *minmax.second;
+        }
+        log_frames = range_index(frame_min, frame_max);
+        find_runs(log_data, frame_min, frame_max, log_run_start, log_run_deviation);
+    }
+
+    // whether timesteps m and n look the same on a y-axis showing a range of the given size (in data units, log10
+    // units for the log data)
+    inline bool looks_identical(int m, int n, double displayed, bool log) const {
+        const QVector<int> & runs = log ? log_run_start : run_start;
+        const QVector<double> & deviation = log ? log_run_deviation : run_deviation;
+        return (runs[m] == runs[n]) && (deviation[m] + deviation[n] <= identical * displayed);
+    }
+
+private:
+    // runs are cut at a tolerance relative to the whole series; the deviations decide per displayed range
+    static inline void find_runs(const QVector<QVector<double>> & frames, const QVector<double> & min, const QVector<double> & max,
+                                 QVector<int> & runs, QVector<double> & deviation) {
+        runs = QVector<int>(frames.size(), 0);
+        deviation = QVector<double>(frames.size(), 0);
+        if (frames.isEmpty()) {
+            return;
+        }
+        double tolerance = identical * (*std::max_element(max.begin(), max.end()) - *std::min_element(min.begin(), min.end()));
+        for (int m = 1; m < frames.size(); ++m) {
+            int r = runs[m - 1];
+            const QVector<double> & first = frames.at(r);
+            const QVector<double> & frame = frames.at(m);
+            bool same = (frame.size() == first.size());
+            double d = 0;
+            for (int j = 0; same && (j < first.size()); ++j) {
+                d = std::max(d, std::abs(frame[j] - first[j]));
+                same = d <= tolerance;
+            }
+            runs[m] = same ? r : m;
+            deviation[m] = same ? d : 0;
+        }
     }
 };
 
 class tgraph_data : public graph_data {
 public:
     QVector<double> data; // the same graph for every timestep
+    range_index index; // min/max over arbitrary time intervals
+    decimation levels; // LTTB-reduced copies for drawing, filled by tobservable::add_data
+    QVector<double> log_data; // log10 of the magnitudes, built by make_log() for logarithmic plots
+    range_index log_index;
     QCPItemTracer * tracer; // a little red dot that indicates the current time
     QCPItemText * label; // indicates the current value
     QCPItemCurve * arrow; // pointing from label to tracer
@@ -36,7 +157,14 @@ public:
     inline tgraph_data() {
     }
     inline tgraph_data(const QString & title, const QVector<double> & data_, double min, double max)
-        : graph_data{title, min, max}, data(data_) , tracer(nullptr), label(nullptr), arrow(nullptr) {
+        : graph_data{title, min, max}, data(data_), index(data_), tracer(nullptr), label(nullptr), arrow(nullptr) {
+    }
+
+    inline void make_log() {
+        if (log_data.isEmpty() && !data.isEmpty()) {
+            log_data = log_magnitude(data, log_floor(data, -30));
+            log_index = range_index(log_data);
+        }
     }
 };
 
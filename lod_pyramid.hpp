@@ -0,0 +1,295 @@
+#ifndef LOD_PYRAMID_HPP
+#define LOD_PYRAMID_HPP
+
+#include <QFile>
+#include <QFutureWatcher>
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+// time-decimated min/mean/max copies of a series of frames (level k: one frame per 2^k timesteps), built in the
+// background into a memory-mapped file next to the run and reused while the hash of the frames matches; the build
+// starts with start(), and the levels begin where one frame covers about a pixel column of the whole run
+class lod_pyramid : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int min_timesteps = 8192; // shorter runs are sampled directly
+    static constexpr int max_columns = 4096;   // widest expected axis rect, finer levels are not stored
+
+    inline lod_pyramid(const QString & file_name, const QVector<QVector<double>> & frames, QObject * parent = nullptr);
+    inline ~lod_pyramid();
+
+    inline void start(); // builds (or finds) the file in the background, once
+    inline bool ready() const;
+    inline int first_level() const;     // lowest level
+    inline int levels() const;          // highest level
+    inline int frames(int level) const; // frames of level (>= first_level())
+    inline const float * frame(int level, int i) const; // min, mean, max of every grid point
+
+signals:
+    void built(); // ready() became true
+
+private slots:
+    inline void finished();
+
+private:
+    // the file starts with a header, followed by the levels first ... levels, each frame n_x * { min, mean, max }
+    class header {
+    public:
+        char magic[8];
+        qint32 n_t;
+        qint32 n_x;
+        qint32 first;
+        qint32 levels;
+        quint64 hash; // of all frames, to notice a different run in the same place
+    };
+    static constexpr const char * magic = "XTLOD03";
+
+    QFile file;
+    QVector<QVector<double>> data; // the frames, until the build starts
+    bool started;
+    const uchar * mapped;
+    qint32 n_t;
+    qint32 n_x;
+    qint32 n_first;
+    qint32 n_levels;
+    std::shared_ptr<quint64> hash; // set by the background task
+    QVector<qint64> offsets; // of every level in the file
+    std::shared_ptr<std::atomic<bool>> cancel;
+    QFutureWatcher<bool> watcher;
+
+    inline qint64 layout(); // fills offsets, returns the file size
+    inline bool open();
+    inline static quint64 hash_frames(const QVector<QVector<double>> & frames, const std::atomic<bool> & cancel);
+    inline static bool same(const header & a, const header & b);
+    inline static bool matches(const QString & file_name, const header & h, qint64 size);
+    inline static bool build(const QString & file_name, const QVector<QVector<double>> & frames, const header & h,
+                             const QVector<qint64> & offsets, qint64 size, const std::atomic<bool> & cancel);
+};
+
+lod_pyramid::lod_pyramid(const QString & file_name, const QVector<QVector<double>> & frames, QObject * parent)
+    : QObject(parent), file(file_name), data(frames), started(false), mapped(nullptr), n_t(frames.size()),
+      n_x(frames.isEmpty() ? 0 : frames[0].size()), n_first(1), n_levels(0), hash(new quint64(0)), cancel(new std::atomic<bool>(false)) {
+    if ((n_t < 2) || (n_x < 1)) {
+        return;
+    }
+    while ((n_t - 1) >> n_levels) {
+        ++n_levels; // until one frame is left
+    }
+    while ((n_first < n_levels) && (this->frames(n_first + 1) >= max_columns)) {
+        ++n_first;
+    }
+    layout();
+}
+
+lod_pyramid::~lod_pyramid() {
+    *cancel = true;
+    watcher.waitForFinished();
+}
+
+void lod_pyramid::start() {
+    if (started || (n_levels == 0)) {
+        return;
+    }
+    started = true;
+    qint64 size = layout();
+
+    header h;
+    std::memset(&h, 0, sizeof(h));
+    std::strncpy(h.magic, magic, sizeof(h.magic));
+    h.n_t = n_t;
+    h.n_x = n_x;
+    h.first = n_first;
+    h.levels = n_levels;
+
+    // hashing reads every frame, so it runs in the background together with the build
+    QObject::connect(&watcher, SIGNAL(finished()), this, SLOT(finished()));
+    QVector<qint64> o = offsets;
+    std::shared_ptr<std::atomic<bool>> c = cancel;
+    std::shared_ptr<quint64> result = hash;
+    QString name = file.fileName();
+    QVector<QVector<double>> series = data;
+    data.clear(); // implicitly shared with the series, the task keeps it
+    watcher.setFuture(QtConcurrent::run([name, series, h, o, size, c, result] () mutable {
+        h.hash = hash_frames(series, *c);
+        *result = h.hash;
+        return !*c && (matches(name, h, size) || build(name, series, h, o, size, *c));
+    }));
+}
+
+bool lod_pyramid::ready() const {
+    return mapped != nullptr;
+}
+
+int lod_pyramid::first_level() const {
+    return n_first;
+}
+
+int lod_pyramid::levels() const {
+    return n_levels;
+}
+
+int lod_pyramid::frames(int level) const {
+    return ((n_t - 1) >> level) + 1;
+}
+
+const float * lod_pyramid::frame(int level, int i) const {
+    return reinterpret_cast<const float *>(mapped + offsets[level] + qint64(i) * n_x * 3 * sizeof(float));
+}
+
+void lod_pyramid::finished() {
+    if (!watcher.result()) {
+        std::cout << "failed to write " << file.fileName().toStdString() << ", the heatmap is sampled directly" << std::endl;
+        return;
+    }
+    if (open()) {
+        emit built();
+    }
+}
+
+qint64 lod_pyramid::layout() {
+    offsets = QVector<qint64>(n_levels + 1, 0);
+    qint64 size = sizeof(header);
+    for (int k = n_first; k <= n_levels; ++k) {
+        offsets[k] = size;
+        size += qint64(frames(k)) * n_x * 3 * sizeof(float);
+    }
+    return size;
+}
+
+// maps the file if it is complete and belongs to the same data
+bool lod_pyramid::open() {
+    if (!file.open(QFile::ReadOnly)) {
+        return false;
+    }
+    header h;
+    bool complete = (file.size() == offsets[n_levels] + qint64(frames(n_levels)) * n_x * 3 * sizeof(float)) &&
+                    (file.read(reinterpret_cast<char *>(&h), sizeof(h)) == sizeof(h)) && (std::strncmp(h.magic, magic, sizeof(h.magic)) == 0) &&
+                    (h.n_t == n_t) && (h.n_x == n_x) && (h.first == n_first) && (h.levels == n_levels) && (h.hash == *hash);
+    if (complete) {
+        mapped = file.map(0, file.size());
+    }
+    if (!mapped) {
+        file.close();
+    }
+    return mapped != nullptr;
+}
+
+// 64-bit FNV-1a over the bits of all values
+quint64 lod_pyramid::hash_frames(const QVector<QVector<double>> & frames, const std::atomic<bool> & cancel) {
+    quint64 h = 14695981039346656037ull;
+    for (int m = 0; (m < frames.size()) && !cancel; ++m) {
+        const QVector<double> & frame = frames.at(m);
+        for (double v : frame) {
+            quint64 bits;
+            std::memcpy(&bits, &v, sizeof(bits));
+            h = (h ^ bits) * 1099511628211ull;
+        }
+        h = (h ^ quint64(frame.size())) * 1099511628211ull;
+    }
+    return h;
+}
+
+// field by field, the padding of the header is undefined
+bool lod_pyramid::same(const header & a, const header & b) {
+    return (std::strncmp(a.magic, b.magic, sizeof(a.magic)) == 0) && (a.n_t == b.n_t) && (a.n_x == b.n_x) && (a.first == b.first) &&
+           (a.levels == b.levels) && (a.hash == b.hash);
+}
+
+// whether the file is complete and was made from the data of h
+bool lod_pyramid::matches(const QString & file_name, const header & h, qint64 size) {
+    QFile in(file_name);
+    header found;
+    return in.open(QFile::ReadOnly) && (in.size() == size) && (in.read(reinterpret_cast<char *>(&found), sizeof(found)) == sizeof(found)) &&
+           same(found, h);
+}
+
+// writes level k from level k - 1 through the mapping, the header last (the means are weighted by the timesteps)
+bool lod_pyramid::build(const QString & file_name, const QVector<QVector<double>> & frames, const header & h,
+                        const QVector<qint64> & offsets, qint64 size, const std::atomic<bool> & cancel) {
+    QFile out(file_name);
+    if (!out.open(QFile::ReadWrite | QFile::Truncate) || !out.resize(size)) {
+        return false;
+    }
+    uchar * p = out.map(0, size);
+    if (!p) {
+        return false;
+    }
+
+    const int n_x = h.n_x;
+    auto level_frame = [&] (int k, int i) {
+        return reinterpret_cast<float *>(p + offsets[k] + qint64(i) * n_x * 3 * sizeof(float));
+    };
+    auto timesteps = [&] (int k, int i) { // behind frame i of level k
+        return std::min(1 << k, h.n_t - (i << k));
+    };
+
+    // the first level from the data
+    int n_first = ((h.n_t - 1) >> h.first) + 1;
+    QVector<double> lo(n_x);
+    QVector<double> sum(n_x);
+    QVector<double> hi(n_x);
+    for (int i = 0; (i < n_first) && !cancel; ++i) {
+        int m0 = i << h.first;
+        int m1 = std::min(m0 + (1 << h.first), h.n_t);
+        lo = frames.at(m0);
+        sum.fill(0);
+        hi = frames.at(m0);
+        for (int m = m0; m < m1; ++m) {
+            const QVector<double> & a = frames.at(m);
+            for (int j = 0; j < n_x; ++j) {
+                lo[j] = std::min(lo[j], a.at(j));
+                sum[j] += a.at(j);
+                hi[j] = std::max(hi[j], a.at(j));
+            }
+        }
+        float * f = level_frame(h.first, i);
+        for (int j = 0; j < n_x; ++j) {
+            f[3 * j + 0] = float(lo[j]);
+            f[3 * j + 1] = float(sum[j] / (m1 - m0));
+            f[3 * j + 2] = float(hi[j]);
+        }
+    }
+
+    // the other levels from the one below
+    for (int k = h.first + 1; (k <= h.levels) && !cancel; ++k) {
+        int n_below = ((h.n_t - 1) >> (k - 1)) + 1;
+        int n_k = ((h.n_t - 1) >> k) + 1;
+        for (int i = 0; (i < n_k) && !cancel; ++i) {
+            const float * a = level_frame(k - 1, 2 * i);
+            float * f = level_frame(k, i);
+            if (2 * i + 1 >= n_below) {
+                std::memcpy(f, a, n_x * 3 * sizeof(float));
+                continue;
+            }
+            const float * b = level_frame(k - 1, 2 * i + 1);
+            float w_a = float(timesteps(k - 1, 2 * i)) / timesteps(k, i);
+            float w_b = 1 - w_a;
+            for (int j = 0; j < n_x; ++j) {
+                f[3 * j + 0] = std::min(a[3 * j + 0], b[3 * j + 0]);
+                f[3 * j + 1] = w_a * a[3 * j + 1] + w_b * b[3 * j + 1];
+                f[3 * j + 2] = std::max(a[3 * j + 2], b[3 * j + 2]);
+            }
+        }
+    }
+
+    if (!cancel) {
+        std::memcpy(p, &h, sizeof(h));
+    }
+    out.unmap(p);
+    out.close();
+    if (cancel) {
+        out.remove();
+        return false;
+    }
+    return true;
+}
+
+#endif
@@ -1,22 +1,39 @@
 #ifndef MAIN_WINDOW_HPP
 #define MAIN_WINDOW_HPP
 
+#include <algorithm>
 #include <armadillo>
 #include <memory>
 #include <vector>
 
+#include <QCheckBox>
 #include <QComboBox>
+#include <QDoubleSpinBox>
 #include <QFile>
 #include <QFileDialog>
+#include <QFutureWatcher>
+#include <QDoubleValidator>
 #include <QGridLayout>
 #include <QLabel>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QMap>
 #include <QPushButton>
+#include <QRegExp>
 #include <QScrollBar>
+#include <QShortcut>
 #include <QWidget>
+#include <QtConcurrent/QtConcurrentRun>
 
 #include "device.hpp"
+#include "event_index.hpp"
+#include "minimap.hpp"
 #include "qcustomplot.hpp"
 #include "observable.hpp"
+#include "playback.hpp"
+#include "plot_widget.hpp"
+#include "quality_governor.hpp"
+#include "scrollbar_preview.hpp"
 
 class main_window : public QWidget
 {
@@ -28,42 +45,137 @@ public:
 private slots:
     inline void load_data();
     inline void select_observable(int index);
+    inline void select_scaling(int index);
     inline void set_time(int val);
+    inline void set_fine_time(int val);
+    inline void jump_to_time();
+    inline void range_changed();
+    inline void panning();
+    inline void plot_mouse_press(QMouseEvent * event);
+    inline void plot_mouse_move(QMouseEvent * event);
+    inline void plot_mouse_release(QMouseEvent * event);
+    inline void events_found();
+    inline void select_event(int row);
+    inline void toggle_playback(bool on);
+    inline void play_frame(int m);
+    inline void prefetch_frames(QVector<int> frames);
+    inline void show_fps(double fps);
+    inline void set_quality(int level);
+    inline void set_contour_levels();
+    inline void toggle_density(bool on);
+    inline void background_ready();
+    inline void choose_overview(int i);
+    inline void overview_clicked(double time);
+    inline void step_time(); // from one of the stepping shortcuts
+
+protected:
+    inline bool eventFilter(QObject * watched, QEvent * event) override;
 
 private:
     QGridLayout layout;
     QPushButton open_button;
     QComboBox selection_box;
+    QComboBox scaling_box;
     QLabel time_label;
-    QCustomPlot plot;
+    plot_widget plot;
     QScrollBar time_scrollbar;
+    minimap overview; // of one time trace, above time_scrollbar
+    scrollbar_preview hover_preview; // thumbnails of the current observable while hovering over time_scrollbar
+    QScrollBar fine_scrollbar; // every timestep of a window around the current one
+    QLineEdit time_edit;
+    QLineEdit contour_edit; // iso-levels of the shown observables
+    QCheckBox density_box;  // overlay of the time window on the profiles
+    QListWidget event_list;
+    QPushButton play_button;
+    QPushButton reverse_button;
+    QDoubleSpinBox speed_box;
+    QLabel fps_label;
 
     QVector<double> x;
     QVector<double> t;
 
     int time_index;
+    int fine_begin; // first timestep covered by fine_scrollbar
+    bool uniform_time; // false if the coarse scrollbar has to be mapped through t
+
+    static constexpr int fine_span = 500; // timesteps left and right of the current one on fine_scrollbar
+    static constexpr int neighbours = 4;  // timesteps prepared on each side of the current one while stepping
+
+    bool selecting_window; // shift-drag on a time plot selects a time window
+    int window_anchor;
 
     std::vector<std::unique_ptr<observable>> observables;
+    QVector<QPair<tobservable *, int>> overview_traces; // the series the overview can show
+    std::vector<observable *> dashboard;  // shown together, one axis rect each, by the last entry of selection_box
+    QVector<QCPAxisRect *> dashboard_rects; // the axis rects added below the default one
+    QCPMarginGroup * dashboard_margins;     // aligns the axis rects of the dashboard
+    QVector<QCPItemStraightLine *> cursors; // the current time in the time plots of the dashboard
+
+    QCPItemStraightLine * crosshair; // at the key of the data point nearest to the mouse, nullptr if not shown
+    QCPItemStraightLine * crosshair_value; // at its value
+    QCPItemText * readout_label;     // its values, in the top left corner of the axis rect
+    QPoint readout_pos;              // the mouse position it was made for
+
+    playback player;
+    bool playing_frame; // set_time_index was called by the player
+
+    quality_governor governor; // lowers the render quality while the user interacts
+
+    QFutureWatcher<QVector<trace_event>> event_watcher; // scans all time traces after loading
+    QVector<trace_event> events; // one entry per row of event_list
+
+    inline void set_time_index(int m);
+    inline int scroll_to_index(int val) const;
+    inline int index_to_scroll(int m) const;
+    inline observable * current_observable();
+    inline bool dashboard_shown() const;
+    inline std::vector<observable *> shown_observables();
+    inline void update_shown();
+    inline void show_dashboard();
+    inline void hide_dashboard();
+    inline int time_to_index(double time) const;
+    inline void set_window(int begin, int end);
+    inline bool update_readout(const QPoint & pos);
+    inline void remove_readout();
 };
 
 //----------------------------------------------------------------------------------------------------------------------
 
 main_window::main_window(QWidget * parent)
-    : QWidget(parent), time_index(0) {
+    : QWidget(parent), overview(&time_scrollbar), hover_preview(&time_scrollbar), time_index(0), fine_begin(0), uniform_time(true), selecting_window(false), window_anchor(0), dashboard_margins(nullptr), crosshair(nullptr), crosshair_value(nullptr), readout_label(nullptr), playing_frame(false), governor(&plot) {
 
     resize(800, 600);
 
     layout.addWidget(&open_button, 0, 0);
     layout.addWidget(&selection_box, 0, 1);
-    layout.addWidget(&time_label, 0, 2);
-    layout.addWidget(&plot, 1, 0, 1, 3);
-    layout.addWidget(&time_scrollbar, 2, 0, 1, 3);
+    layout.addWidget(&scaling_box, 0, 2);
+    layout.addWidget(&time_label, 0, 3);
+    layout.addWidget(&plot, 1, 0, 1, 4);
+    layout.addWidget(&overview, 2, 0, 1, 4);
+    layout.addWidget(&time_scrollbar, 3, 0, 1, 4);
+    layout.addWidget(&fine_scrollbar, 4, 0, 1, 3);
+    layout.addWidget(&time_edit, 4, 3);
+    layout.addWidget(&play_button, 5, 0);
+    layout.addWidget(&reverse_button, 5, 1);
+    layout.addWidget(&speed_box, 5, 2);
+    layout.addWidget(&fps_label, 5, 3);
+    layout.addWidget(&contour_edit, 6, 0, 1, 3);
+    layout.addWidget(&density_box, 6, 3);
+    layout.addWidget(&event_list, 0, 4, 7, 1);
     setLayout(&layout);
 
+    event_list.setMaximumWidth(260);
+
     open_button.setText("Open Directory");
 
     selection_box.setEnabled(false);
 
+    // order has to match observable::scale_mode
+    scaling_box.addItem("Global range");
+    scaling_box.addItem("Per-frame range");
+    scaling_box.addItem("Time window range");
+    scaling_box.addItem("Visible range");
+
     plot.setInteraction(QCP::iRangeDrag, true);
     plot.setInteraction(QCP::iRangeZoom, true);
 
@@ -71,24 +183,116 @@ main_window::main_window(QWidget * parent)
     plot.legend->setBrush(QBrush(QColor(255,255,255,130))); //transparent white
     plot.axisRect()->insetLayout()->setInsetAlignment(0, Qt::AlignTop|Qt::AlignRight);
 
+    // the scrollbars don't take the focus, the arrow keys step the time through the shortcuts below
     time_scrollbar.setOrientation(Qt::Horizontal);
     time_scrollbar.setTracking(true);
-    time_scrollbar.setRange(0, 9999);
+    time_scrollbar.setRange(0, 0);
     time_scrollbar.setValue(0);
+    time_scrollbar.setFocusPolicy(Qt::NoFocus);
     time_scrollbar.setEnabled(false);
 
+    fine_scrollbar.setOrientation(Qt::Horizontal);
+    fine_scrollbar.setTracking(true);
+    fine_scrollbar.setRange(0, 0);
+    fine_scrollbar.setFocusPolicy(Qt::NoFocus);
+    fine_scrollbar.setEnabled(false);
+
+    hover_preview.set_render([this] (QImage & image, int value) {
+        observable * o = current_observable();
+        if (!o || t.isEmpty()) {
+            return false;
+        }
+        int m = scroll_to_index(value);
+        o->preview(image, m);
+        QPainter painter(&image);
+        painter.drawText(4, 14, QString::number(t[m] * 1e12, 'f', 3) + " ps");
+        return true;
+    });
+
+    time_edit.setPlaceholderText("jump to t / ps");
+    time_edit.setValidator(new QDoubleValidator(&time_edit));
+    time_edit.setEnabled(false);
+
+    contour_edit.setPlaceholderText("contour levels, e.g. 0.1, 0.2");
+    contour_edit.setEnabled(false);
+
+    density_box.setText("Window density");
+    density_box.setChecked(true);
+    density_box.setFocusPolicy(Qt::NoFocus);
+
+    play_button.setText("Play");
+    play_button.setCheckable(true);
+    play_button.setEnabled(false);
+    reverse_button.setText("Reverse");
+    reverse_button.setCheckable(true);
+    speed_box.setRange(1, 1e7);
+    speed_box.setDecimals(0);
+    speed_box.setSuffix(" timesteps/s");
+    speed_box.setValue(100);
+    player.set_speed(speed_box.value());
+
     QObject::connect(&open_button, SIGNAL(clicked()), this, SLOT(load_data()));
     QObject::connect(&selection_box, SIGNAL(currentIndexChanged(int)), this, SLOT(select_observable(int)));
     QObject::connect(&time_scrollbar, SIGNAL(valueChanged(int)), this, SLOT(set_time(int)));
+    QObject::connect(&fine_scrollbar, SIGNAL(valueChanged(int)), this, SLOT(set_fine_time(int)));
+    QObject::connect(&time_edit, SIGNAL(returnPressed()), this, SLOT(jump_to_time()));
+    QObject::connect(&contour_edit, SIGNAL(returnPressed()), this, SLOT(set_contour_levels()));
+    QObject::connect(&density_box, SIGNAL(toggled(bool)), this, SLOT(toggle_density(bool)));
+    QObject::connect(&overview, SIGNAL(trace_chosen(int)), this, SLOT(choose_overview(int)));
+    QObject::connect(&overview, SIGNAL(time_clicked(double)), this, SLOT(overview_clicked(double)));
+    QObject::connect(&scaling_box, SIGNAL(currentIndexChanged(int)), this, SLOT(select_scaling(int)));
+    QObject::connect(plot.xAxis, SIGNAL(rangeChanged(QCPRange)), this, SLOT(range_changed()));
+    QObject::connect(&plot, SIGNAL(panning()), this, SLOT(panning()));
+    QObject::connect(&plot, SIGNAL(mousePress(QMouseEvent*)), this, SLOT(plot_mouse_press(QMouseEvent*)));
+    QObject::connect(&plot, SIGNAL(mouseMove(QMouseEvent*)), this, SLOT(plot_mouse_move(QMouseEvent*)));
+    QObject::connect(&plot, SIGNAL(mouseRelease(QMouseEvent*)), this, SLOT(plot_mouse_release(QMouseEvent*)));
+    QObject::connect(&event_list, SIGNAL(currentRowChanged(int)), this, SLOT(select_event(int)));
+    QObject::connect(&play_button, SIGNAL(toggled(bool)), this, SLOT(toggle_playback(bool)));
+    QObject::connect(&reverse_button, SIGNAL(toggled(bool)), &player, SLOT(set_reverse(bool)));
+    QObject::connect(&speed_box, SIGNAL(valueChanged(double)), &player, SLOT(set_speed(double)));
+    QObject::connect(&player, SIGNAL(frame(int)), this, SLOT(play_frame(int)));
+    QObject::connect(&player, SIGNAL(upcoming(QVector<int>)), this, SLOT(prefetch_frames(QVector<int>)));
+    QObject::connect(&player, SIGNAL(fps(double)), this, SLOT(show_fps(double)));
+    QObject::connect(&player, SIGNAL(finished()), &play_button, SLOT(toggle()));
+    QObject::connect(&plot, SIGNAL(mouseWheel(QWheelEvent*)), &governor, SLOT(touch()));
+    QObject::connect(&governor, SIGNAL(changed(int)), this, SLOT(set_quality(int)), Qt::QueuedConnection); // not from inside a replot
+    plot.installEventFilter(this); // hides the readout when the mouse leaves the plot
+
+    // hierarchical stepping from anywhere in the window (a focused line edit keeps its own cursor keys)
+    for (int key : { Qt::Key_Right, Qt::Key_Left, Qt::Key_PageDown, Qt::Key_PageUp, Qt::Key_Home, Qt::Key_End }) {
+        for (int modifiers : { 0, int(Qt::SHIFT), int(Qt::CTRL), int(Qt::CTRL | Qt::SHIFT) }) {
+            QShortcut * s = new QShortcut(QKeySequence(key | modifiers), this);
+            s->setContext(Qt::WindowShortcut);
+            QObject::connect(s, SIGNAL(activated()), this, SLOT(step_time()));
+        }
+    }
 }
 
 void main_window::load_data() {
     // clear old data
+    play_button.setChecked(false);
+    play_button.setEnabled(false);
+    event_watcher.waitForFinished(); // the scan still reads the old traces
+    // its finished() may still be queued and would arrive in the dialog's event loop, after the observables are gone
+    QObject::disconnect(&event_watcher, SIGNAL(finished()), this, SLOT(events_found()));
+    event_list.clear();
+    events.clear();
+    hide_dashboard();
+    dashboard.clear();
     observables.clear();
+    overview_traces.clear();
+    overview.clear();
+    hover_preview.clear();
+    remove_readout();
 
-    plot.clearGraphs();
+    plot.clearPlottables(); // the maps and contours too, not only the graphs
+    plot.clearItems();
+    plot.clear_frames();
     time_scrollbar.setValue(0);
     time_scrollbar.setEnabled(false);
+    fine_scrollbar.setEnabled(false);
+    time_edit.setEnabled(false);
+    contour_edit.setEnabled(false);
     selection_box.clear();
     selection_box.setCurrentIndex(0);
     selection_box.setEnabled(false);
@@ -192,7 +396,10 @@ void main_window::load_data() {
             xobservable * bandstructure = new xobservable("Bandstructure", "phi / V", x, t);
             bandstructure->add_data({ "Valence Band", vband, vbandmin, vbandmax });
             bandstructure->add_data({ "Conduction Band", cband, cbandmin, cbandmax });
+            bandstructure->contour_levels = { d.F_s }; // where the bands cross the source Fermi level
+            bandstructure->band_gap = true;
             observables.push_back(std::move(std::unique_ptr<xobservable>(bandstructure)));
+            dashboard.push_back(bandstructure);
         } else {
             std::cout << "failed to load phi data!" << std::endl;
         }
@@ -205,6 +412,11 @@ void main_window::load_data() {
         xobservable * charge_density = new xobservable("Charge density", "n / C m^-3", x, t);
         charge_density->add_data({ "Charge density", n, nmin, nmax });
         observables.push_back(std::move(std::unique_ptr<observable>(charge_density)));
+        dashboard.push_back(charge_density);
+
+        xobservable * charge_density_log = new xobservable("Charge density with logscale", "|n| / C m^-3", x, t, true);
+        charge_density_log->add_data({ "Charge density", n, nmin, nmax });
+        observables.push_back(std::move(std::unique_ptr<observable>(charge_density_log)));
     } else {
         std::cout << "failed to load n data!" << std::endl;
     }
@@ -216,10 +428,11 @@ void main_window::load_data() {
         xobservable * current = new xobservable("Current (spatial)", "I / A", x, t);
         current->add_data({ "Current", I, Imin, Imax });
         observables.push_back(std::move(std::unique_ptr<observable>(current)));
+        dashboard.push_back(current);
 
-//        xobservable * current_log = new xobservable("Current (spatial) with logscale", "I / A", x, t, true);
-//        current_log->add_data({ "Current", I, Imin, Imax });
-//        observables.push_back(std::move(std::unique_ptr<observable>(current_log)));
+        xobservable * current_log = new xobservable("Current (spatial) with logscale", "|I| / A", x, t, true);
+        current_log->add_data({ "Current", I, Imin, Imax });
+        observables.push_back(std::move(std::unique_ptr<observable>(current_log)));
 
         QVector<double> I_s(I.size());
         QVector<double> I_d(I.size());
@@ -253,17 +466,24 @@ void main_window::load_data() {
         current_s->add_data({ "Source Current", I_s, Ismin, Ismax });
         observables.push_back(std::move(std::unique_ptr<observable>(current_s)));
 
-//        tobservable * current_s_log = new tobservable("Source Current with logscale", "I / A", x, t, true);
-//        current_s_log->add_data({ "Source Current", I_s, Ismin, Ismax });
-//        observables.push_back(std::move(std::unique_ptr<observable>(current_s_log)));
+        tobservable * current_s_log = new tobservable("Source Current with logscale", "|I| / A", x, t, true);
+        current_s_log->add_data({ "Source Current", I_s, Ismin, Ismax });
+        observables.push_back(std::move(std::unique_ptr<observable>(current_s_log)));
 
         tobservable * current_d = new tobservable("Drain Current", "I / A", x, t);
         current_d->add_data({ "Drain Current", I_d, Idmin, Idmax });
         observables.push_back(std::move(std::unique_ptr<observable>(current_d)));
 
-//        tobservable * current_d_log = new tobservable("Drain Current with logscale", "I / A", x, t, true);
-//        current_d_log->add_data({ "Drain Current", I_d, Idmin, Idmax });
-//        observables.push_back(std::move(std::unique_ptr<observable>(current_d_log)));
+        tobservable * current_d_log = new tobservable("Drain Current with logscale", "|I| / A", x, t, true);
+        current_d_log->add_data({ "Drain Current", I_d, Idmin, Idmax });
+        observables.push_back(std::move(std::unique_ptr<observable>(current_d_log)));
+
+        tobservable * current_sd = new tobservable("Source and Drain Current", "I / A", x, t);
+        current_sd->add_data({ "Source Current", I_s, std::min(Ismin, Idmin), std::max(Ismax, Idmax) });
+        current_sd->add_data({ "Drain Current", I_d, std::min(Ismin, Idmin), std::max(Ismax, Idmax) });
+        current_sd->derived = true;
+        observables.push_back(std::move(std::unique_ptr<observable>(current_sd)));
+        dashboard.push_back(current_sd);
     } else {
         std::cout << "failed to load I data!" << std::endl;
     }
@@ -278,14 +498,119 @@ void main_window::load_data() {
             voltage->add_data({ "V_g", V[2], Vmin, Vmax });
             voltage->add_data({ "V_d", V[1], Vmin, Vmax });
             observables.push_back(std::move(std::unique_ptr<observable>(voltage)));
+            dashboard.push_back(voltage);
         }
     } else {
         std::cout << "failed to load V data!" << std::endl;
     }
 
+    // every spatial observable can also be shown as a heatmap over time, one per series
+    std::vector<xobservable *> spatial;
+    for (auto & o : observables) {
+        if (xobservable * xo = dynamic_cast<xobservable *>(o.get())) {
+            spatial.push_back(xo);
+        }
+    }
+    QMap<QString, std::shared_ptr<lod_pyramid>> pyramids; // per series, the linear and the log map share one
+    for (xobservable * xo : spatial) {
+        for (int i = 0; i < xo->data.size(); ++i) {
+            if (xo->logscale) {
+                xo->data[i].make_log(); // once, the map shares it
+            }
+            QString map_title = xo->title + ((xo->data.size() > 1) ? ": " + xo->data[i].title : QString()) + " (x-t map)";
+            hobservable * map = new hobservable(map_title, xo->ylabel, x, t, xo->data[i], xo->logscale);
+            map->contour_levels = xo->contour_levels;
+            QObject::connect(map->contours.get(), SIGNAL(extracted()), this, SLOT(background_ready()));
+
+            // long runs get a level-of-detail pyramid in the run directory, built in the background when first shown
+            if (t.size() >= lod_pyramid::min_timesteps) {
+                QString series = xo->data[i].title;
+                if (!pyramids.contains(series)) {
+                    QString file_name = series;
+                    file_name.replace(QRegExp("[^A-Za-z0-9]+"), "_");
+                    pyramids[series].reset(new lod_pyramid(dir + "/" + file_name + ".lod", map->data.data));
+                    QObject::connect(pyramids[series].get(), SIGNAL(built()), this, SLOT(background_ready()));
+                }
+                map->pyramid = pyramids[series];
+            }
+            observables.push_back(std::move(std::unique_ptr<observable>(map)));
+        }
+    }
+
+    for (auto & o : observables) {
+        o->scaling = static_cast<observable::scale_mode>(scaling_box.currentIndex());
+        o->quality = governor.level();
+    }
+
+    // the overview above the scrollbar can show any time trace, the drain current by default
+    QStringList overview_names;
+    int overview_default = 0;
+    for (auto & o : observables) {
+        tobservable * to = dynamic_cast<tobservable *>(o.get());
+        if (to && !to->logscale && !to->derived) {
+            for (int i = 0; i < to->data.size(); ++i) {
+                if (to->data[i].title == "Drain Current") {
+                    overview_default = overview_traces.size();
+                }
+                overview_traces.push_back({ to, i });
+                overview_names << ((to->data.size() > 1) ? to->title + ": " + to->data[i].title : to->title);
+            }
+        }
+    }
+    overview.set_traces(overview_names, overview_default);
+    choose_overview(overview_default);
+    for (auto & o : observables) {
+        if (xobservable * xo = dynamic_cast<xobservable *>(o.get())) {
+            xo->show_density = density_box.isChecked();
+        }
+    }
+
+    // scan all time traces for events in the background (the vectors are implicitly shared, not copied)
+    QVector<QVector<double>> traces;
+    QVector<QPair<int, int>> owners; // observable and series of every trace
+    for (unsigned o = 0; o < observables.size(); ++o) {
+        tobservable * to = dynamic_cast<tobservable *>(observables[o].get());
+        if (to && !to->logscale && !to->derived) { // copies would only repeat the events
+            for (int i = 0; i < to->data.size(); ++i) {
+                traces.push_back(to->data[i].data);
+                owners.push_back({ int(o), i });
+            }
+        }
+    }
+    QVector<double> time = t;
+    QObject::connect(&event_watcher, SIGNAL(finished()), this, SLOT(events_found()));
+    event_watcher.setFuture(QtConcurrent::run([time, traces, owners] () {
+        QVector<trace_event> found;
+        for (int i = 0; i < traces.size(); ++i) {
+            found += find_events(time, traces[i], owners[i].first, owners[i].second);
+        }
+        std::stable_sort(found.begin(), found.end(), [] (const trace_event & a, const trace_event & b) {
+            return a.index < b.index;
+        });
+        return found;
+    }));
+
+    // one coarse scrollbar step per timestep; with non-uniform ttics the coarse scrollbar is linear in time instead
+    uniform_time = true;
+    for (int m = 2; m < t.size(); ++m) {
+        if (std::abs((t[m] - t[m - 1]) - (t[1] - t[0])) > 1e-3 * std::abs(t[1] - t[0])) {
+            uniform_time = false;
+            break;
+        }
+    }
+    time_scrollbar.setRange(0, t.size() - 1);
+    time_scrollbar.setPageStep(std::max(1, t.size() / 100));
+    fine_scrollbar.setRange(0, std::min(2 * fine_span, t.size() - 1));
+    fine_scrollbar.setPageStep(10);
+    fine_begin = 0;
+
     // set time to 0
     time_scrollbar.setEnabled(true);
-    time_scrollbar.setValue(0); // calls set_time
+    fine_scrollbar.setEnabled(true);
+    time_edit.setEnabled(true);
+    contour_edit.setEnabled(true);
+    play_button.setEnabled(true);
+    set_time_index(0); // the scrollbars are at 0 already, so they don't call set_time
 
     // add entries in dropdown-menu
     selection_box.setEnabled(true);
@@ -293,18 +618,142 @@ void main_window::load_data() {
     for (unsigned i = 0; i < observables.size(); ++i) {
         selection_box.addItem(observables[i]->title);
     }
+    if (dashboard.size() > 1) {
+        selection_box.addItem("Dashboard"); // index observables.size()
+    }
     selection_box.setCurrentIndex(0); // calls select_observable(int)
 }
 
 void main_window::select_observable(int index) {
+    hover_preview.clear();
+    remove_readout();
     if ((unsigned)index < observables.size()) {
+        plot.clear_frames();
+        hide_dashboard();
+        for (auto & o : observables) {
+            o->hide(); // the graphs of the other observables stay in the plot
+        }
+        observables[index]->rect = nullptr;
+        plot.xAxis->blockSignals(true); // setup changes the x-range before the observable is refreshed
         observables[index]->setup(plot);
+        plot.xAxis->blockSignals(false);
         observables[index]->update(plot, time_index);
+
+        QStringList levels;
+        for (double l : observables[index]->contour_levels) {
+            levels << QString::number(l);
+        }
+        contour_edit.setText(levels.join(", "));
+        contour_edit.setStyleSheet(QString()); // valid, whatever was marked before
+        contour_edit.setToolTip(QString());
+    } else if (((unsigned)index == observables.size()) && !dashboard.empty()) {
+        plot.clear_frames();
+        show_dashboard();
     }
 }
 
+void main_window::select_scaling(int index) {
+    for (auto & o : observables) {
+        o->scaling = static_cast<observable::scale_mode>(index);
+    }
+    plot.clear_frames();
+
+    // with automatic y-scaling, only the x-axis is left to the user
+    Qt::Orientations o = (index == observable::scale_global) ? (Qt::Horizontal | Qt::Vertical) : Qt::Horizontal;
+    for (QCPAxisRect * r : plot.axisRects()) {
+        r->setRangeDrag(o);
+        r->setRangeZoom(o);
+    }
+
+    if (index == observable::scale_global) {
+        for (observable * ob : shown_observables()) {
+            ob->reset_y_range(plot);
+        }
+    }
+    update_shown();
+}
+
 void main_window::set_time(int val) {
-    time_index = val * t.size() / (time_scrollbar.maximum() + 1);
+    int m = scroll_to_index(val);
+    fine_begin = std::max(0, std::min(m - fine_span, t.size() - 1 - fine_scrollbar.maximum())); // recenter
+    set_time_index(m);
+}
+
+void main_window::set_fine_time(int val) {
+    set_time_index(fine_begin + val);
+}
+
+void main_window::jump_to_time() {
+    bool ok;
+    double ps = time_edit.text().toDouble(&ok);
+    if (ok && !t.isEmpty()) {
+        set_time_index(time_to_index(ps * 1e-12));
+    }
+}
+
+// the levels are comma separated, an empty list removes the contours
+void main_window::set_contour_levels() {
+    QVector<double> levels;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    QStringList parts = contour_edit.text().split(",", Qt::SkipEmptyParts);
+#else
+    QStringList parts = contour_edit.text().split(",", QString::SkipEmptyParts);
+#endif
+    for (const QString & s : parts) {
+        bool ok;
+        double l = s.trimmed().toDouble(&ok);
+        if (!ok) {
+            // marked until the next valid input
+            contour_edit.setStyleSheet("QLineEdit { background: #f6c1c5; }");
+            contour_edit.setToolTip("invalid contour level: " + s.trimmed());
+            return;
+        }
+        levels.push_back(l);
+    }
+    contour_edit.setStyleSheet(QString());
+    contour_edit.setToolTip(QString());
+    for (observable * o : shown_observables()) {
+        o->contour_levels = levels;
+    }
+    plot.clear_frames();
+    update_shown();
+}
+
+void main_window::toggle_density(bool on) {
+    for (auto & o : observables) {
+        if (xobservable * xo = dynamic_cast<xobservable *>(o.get())) {
+            xo->show_density = on;
+        }
+    }
+    plot.clear_frames();
+    update_shown();
+}
+
+void main_window::set_time_index(int m) {
+    if (t.isEmpty()) {
+        return;
+    }
+    time_index = std::max(0, std::min(m, t.size() - 1));
+    m = time_index;
+
+    if (!playing_frame) {
+        player.seek(m);
+    }
+    governor.touch();
+
+    // keep both scrollbars in sync with the exact timestep, whichever way it was set
+    if (scroll_to_index(time_scrollbar.value()) != m) {
+        time_scrollbar.blockSignals(true);
+        time_scrollbar.setValue(index_to_scroll(m));
+        time_scrollbar.blockSignals(false);
+    }
+    if ((m < fine_begin) || (m > fine_begin + fine_scrollbar.maximum())) {
+        fine_begin = std::max(0, std::min(m - fine_span, t.size() - 1 - fine_scrollbar.maximum()));
+    }
+    fine_scrollbar.blockSignals(true);
+    fine_scrollbar.setValue(m - fine_begin);
+    fine_scrollbar.blockSignals(false);
+    overview.set_position(m);
 
     // update the time_label
     QString qs = "t = ";
@@ -314,9 +763,476 @@ void main_window::set_time(int val) {
     qts << t[time_index] * 1e12 << " ps";
     time_label.setText(qs);
 
+    if (((unsigned)selection_box.currentIndex() < observables.size()) && crosshair) {
+        // not cached while the readout is shown, the frames would keep it
+        bool dirty = observables[selection_box.currentIndex()]->refresh(plot, time_index);
+        if (update_readout(readout_pos) || dirty) {
+            plot.replot();
+        }
+    } else if ((unsigned)selection_box.currentIndex() < observables.size()) {
+        // armed only if a replot follows, the next unrelated replot must not be taken for this frame
+        if (observables[selection_box.currentIndex()]->refresh(plot, time_index)) {
+            plot.set_frame(selection_box.currentIndex(), time_index, governor.level() == quality_governor::full); // revisited frames are drawn from the cache
+            plot.replot();
+        }
+        fps_label.setToolTip(plot.cache_stats());
+    } else if (dashboard_shown()) {
+        if (crosshair) {
+            update_readout(readout_pos); // replotted by update_shown
+        }
+        update_shown(); // not cached, the frame key only covers one axis rect
+        fps_label.setToolTip(QString());
+    }
+
+    // while stepping by hand the next frame is most likely a neighbour (the player requests its own frames)
+    if (!playing_frame) {
+        QVector<int> next;
+        for (int k = 1; k <= neighbours; ++k) {
+            for (int n : { m + k, m - k }) {
+                if ((n >= 0) && (n < t.size())) {
+                    next.push_back(n);
+                }
+            }
+        }
+        prefetch_frames(next);
+    }
+}
+
+void main_window::toggle_playback(bool on) {
+    if (on) {
+        play_button.setText("Pause");
+        player.play(time_index, t.size());
+    } else {
+        play_button.setText("Play");
+        player.pause();
+    }
+}
+
+void main_window::play_frame(int m) {
+    playing_frame = true;
+    set_time_index(m);
+    playing_frame = false;
+}
+
+void main_window::prefetch_frames(QVector<int> frames) {
+    for (observable * o : shown_observables()) {
+        o->prefetch(plot, frames);
+    }
+}
+
+void main_window::show_fps(double fps) {
+    QString qs;
+    QTextStream qts(&qs);
+    qts.setRealNumberNotation(QTextStream::FixedNotation);
+    qts.setRealNumberPrecision(1);
+    qts << fps << " fps (every " << player.stride() << ". timestep)";
+    fps_label.setText(qs);
+}
+
+void main_window::set_quality(int level) {
+    plot.setNotAntialiasedElements(level >= quality_governor::no_antialiasing ? QCP::aeAll : QCP::aeNone);
+    for (auto & o : observables) {
+        o->quality = level;
+    }
+    update_shown();
+}
+
+// a level-of-detail pyramid or the iso-lines of a contour level are there
+void main_window::background_ready() {
+    plot.clear_frames(); // drawn without them
+    update_shown();
+}
+
+void main_window::choose_overview(int i) {
+    if ((i >= 0) && (i < overview_traces.size())) {
+        overview.set_trace(t, overview_traces[i].first->data[overview_traces[i].second].index);
+    }
+}
+
+void main_window::overview_clicked(double time) {
+    set_time_index(time_to_index(time));
+}
+
+int main_window::scroll_to_index(int val) const {
+    if (uniform_time || (t.size() < 2)) {
+        return val;
+    }
+    return time_to_index(t[0] + (t[t.size() - 1] - t[0]) * val / (t.size() - 1));
+}
+
+int main_window::index_to_scroll(int m) const {
+    if (uniform_time || (t.size() < 2)) {
+        return m;
+    }
+    return int(std::round((t[m] - t[0]) / (t[t.size() - 1] - t[0]) * (t.size() - 1)));
+}
+
+void main_window::step_time() {
+    QShortcut * s = qobject_cast<QShortcut *>(sender());
+    if (!s || t.isEmpty()) {
+        return;
+    }
+    int key = s->key()[0] & ~Qt::KeyboardModifierMask;
+    int modifiers = s->key()[0] & Qt::KeyboardModifierMask;
+
+    // hierarchical stepping: 1, 10 (shift) or 100 (ctrl) timesteps; a page is 1% of the run
+    int step = 1;
+    if (modifiers & Qt::SHIFT) {
+        step = 10;
+    }
+    if (modifiers & Qt::CTRL) {
+        step = 100;
+    }
+
+    switch (key) {
+    case Qt::Key_Right:
+        set_time_index(time_index + step);
+        break;
+    case Qt::Key_Left:
+        set_time_index(time_index - step);
+        break;
+    case Qt::Key_PageDown:
+        set_time_index(time_index + time_scrollbar.pageStep());
+        break;
+    case Qt::Key_PageUp:
+        set_time_index(time_index - time_scrollbar.pageStep());
+        break;
+    case Qt::Key_Home:
+        set_time_index(0);
+        break;
+    case Qt::Key_End:
+        set_time_index(t.size() - 1);
+        break;
+    }
+}
+
+void main_window::events_found() {
+    if (!event_watcher.isFinished()) {
+        return; // signal of a scan that was replaced by a newer one
+    }
+
+    events = event_watcher.result();
+    overview.set_events(events);
+    for (const trace_event & e : events) {
+        tobservable * to = ((unsigned)e.observable < observables.size()) ? dynamic_cast<tobservable *>(observables[e.observable].get()) : nullptr;
+        if (!to || (e.series < 0) || (e.series >= to->data.size()) || (e.index < 0) || (e.index >= t.size())) {
+            continue; // not from the loaded run
+        }
+        to->events.push_back(e);
+
+        QString qs;
+        QTextStream qts(&qs);
+        qts.setRealNumberNotation(QTextStream::FixedNotation);
+        qts.setRealNumberPrecision(3);
+        qts << to->data[e.series].title << ": " << e.name() << " at " << t[e.index] * 1e12 << " ps";
+        event_list.addItem(qs);
+    }
+
+    // show the markers in the open time plots, keeping their zoom (the cached frames are without them)
+    bool shown = false;
+    for (observable * o : shown_observables()) {
+        if (tobservable * to = dynamic_cast<tobservable *>(o)) {
+            to->update_markers();
+            shown = true;
+        }
+    }
+    if (shown) {
+        plot.clear_frames();
+        plot.replot();
+    }
+}
+
+void main_window::select_event(int row) {
+    if ((row >= 0) && (row < events.size())) {
+        set_time_index(events[row].index);
+    }
+}
+
+void main_window::range_changed() {
+    bool dirty = false;
+    for (observable * o : shown_observables()) {
+        if (o->range_dependent()) {
+            dirty |= o->refresh(plot, time_index);
+        }
+    }
+    if (dirty) {
+        plot.replot();
+    }
+}
+
+// during a drag the axes don't signal, but the decimated traces and sampled maps still have to cover the exposed
+// strips; the plot replots after this
+void main_window::panning() {
+    for (observable * o : shown_observables()) {
+        if (o->range_dependent()) {
+            o->refresh(plot, time_index);
+        }
+    }
+}
+
+void main_window::plot_mouse_press(QMouseEvent * event) {
+    if (!dynamic_cast<tobservable *>(current_observable()) || !(event->modifiers() & Qt::ShiftModifier)) {
+        return;
+    }
+
+    // the press is forwarded to the axis rect after this signal, so dragging is switched off in time
+    plot.setInteraction(QCP::iRangeDrag, false);
+    selecting_window = true;
+    window_anchor = time_to_index(plot.xAxis->pixelToCoord(event->pos().x()));
+    set_window(window_anchor, window_anchor);
+}
+
+void main_window::plot_mouse_move(QMouseEvent * event) {
+    if (event->buttons() != Qt::NoButton) {
+        governor.touch(); // dragging
+    }
+    if (selecting_window) {
+        int i = time_to_index(plot.xAxis->pixelToCoord(event->pos().x()));
+        set_window(std::min(i, window_anchor), std::max(i, window_anchor));
+    } else if ((event->buttons() == Qt::NoButton) && update_readout(event->pos())) {
+        plot.disarm(); // a frame still waiting for its lines would be stored with the crosshair
+        plot.replot();
+    }
+}
+
+void main_window::plot_mouse_release(QMouseEvent * event) {
+    Q_UNUSED(event);
+
+    if (selecting_window) {
+        selecting_window = false;
+        plot.setInteraction(QCP::iRangeDrag, true);
+
+        // a plain shift-click clears the selection
+        observable * o = current_observable();
+        if (o && (o->window_begin == o->window_end)) {
+            set_window(0, -1);
+        }
+    }
+}
+
+observable * main_window::current_observable() {
     if ((unsigned)selection_box.currentIndex() < observables.size()) {
-        observables[selection_box.currentIndex()]->update(plot, time_index);
+        return observables[selection_box.currentIndex()].get();
+    }
+    return nullptr;
+}
+
+int main_window::time_to_index(double time) const {
+    // nearest timestep; t does not need to be uniformly spaced
+    auto it = std::lower_bound(t.begin(), t.end(), time);
+    if (it == t.end()) {
+        return t.size() - 1;
+    }
+    if ((it != t.begin()) && (time - *(it - 1) < *it - time)) {
+        --it;
+    }
+    return it - t.begin();
+}
+
+void main_window::set_window(int begin, int end) {
+    for (auto & o : observables) {
+        o->window_begin = begin;
+        o->window_end = end;
+    }
+    overview.set_window(begin, end);
+    plot.clear_frames();
+    update_shown();
+}
+
+bool main_window::dashboard_shown() const {
+    return !dashboard_rects.isEmpty();
+}
+
+std::vector<observable *> main_window::shown_observables() {
+    if (dashboard_shown()) {
+        return dashboard;
+    }
+    std::vector<observable *> shown;
+    if (current_observable()) {
+        shown.push_back(current_observable());
+    }
+    return shown;
+}
+
+// brings all shown observables to the current timestep, with one replot for all of them (if any changed)
+void main_window::update_shown() {
+    if (t.isEmpty()) {
+        return;
+    }
+    QVector<QCPAxisRect *> changed;
+    for (observable * o : shown_observables()) {
+        if (o->refresh(plot, time_index)) {
+            changed.push_back(o->x_axis(plot)->axisRect());
+        }
+    }
+    for (QCPItemStraightLine * c : cursors) {
+        if (changed.contains(c->clipAxisRect())) { // the tracers in its axis rect moved, so does the time
+            c->point1->setCoords(t[time_index], 0);
+            c->point2->setCoords(t[time_index], 1);
+        }
+    }
+    if (!changed.isEmpty()) {
+        plot.replot();
+    }
+}
+
+// one axis rect per observable of the dashboard, stacked below the default axis rect (which shows the first one)
+void main_window::show_dashboard() {
+    hide_dashboard();
+    remove_readout();
+    for (auto & ob : observables) {
+        ob->hide();
+    }
+
+    Qt::Orientations o = (scaling_box.currentIndex() == observable::scale_global) ? (Qt::Horizontal | Qt::Vertical) : Qt::Horizontal;
+    dashboard_margins = new QCPMarginGroup(&plot);
+    plot.axisRect()->setMarginGroup(QCP::msLeft | QCP::msRight, dashboard_margins);
+    for (unsigned k = 0; k < dashboard.size(); ++k) {
+        QCPAxisRect * r = plot.axisRect();
+        if (k > 0) {
+            r = new QCPAxisRect(&plot);
+            plot.plotLayout()->addElement(k, 0, r);
+            r->setMarginGroup(QCP::msLeft | QCP::msRight, dashboard_margins);
+            r->setRangeDrag(o);
+            r->setRangeZoom(o);
+            r->setLayer("background"); // the same layers as the default axis rect
+            for (QCPAxis * a : r->axes()) {
+                a->setLayer("axes");
+                a->grid()->setLayer("grid");
+            }
+            QObject::connect(r->axis(QCPAxis::atBottom), SIGNAL(rangeChanged(QCPRange)), this, SLOT(range_changed()));
+            dashboard_rects.push_back(r);
+        }
+
+        observable * ob = dashboard[k];
+        ob->rect = (k > 0) ? r : nullptr;
+        ob->x_axis(plot)->blockSignals(true);
+        ob->setup(plot);
+        ob->x_axis(plot)->blockSignals(false);
+
+        if (dynamic_cast<tobservable *>(ob)) {
+            QCPItemStraightLine * c = new QCPItemStraightLine(&plot);
+            plot.addItem(c);
+            for (QCPItemPosition * p : { c->point1, c->point2 }) {
+                p->setAxes(ob->x_axis(plot), ob->y_axis(plot));
+                p->setAxisRect(r);
+                p->setTypeY(QCPItemPosition::ptAxisRectRatio);
+            }
+            c->setClipAxisRect(r);
+            c->setPen(QPen(Qt::gray, 0, Qt::DashLine));
+            cursors.push_back(c);
+        }
+    }
+    update_shown();
+}
+
+void main_window::hide_dashboard() {
+    if (!dashboard_shown()) {
+        return;
+    }
+    remove_readout(); // may be in one of the removed axis rects
+    // the graphs and items in the removed axis rects must not outlive their axes
+    for (observable * o : dashboard) {
+        if (o->rect) {
+            o->remove(plot);
+        }
+    }
+    for (QCPItemStraightLine * c : cursors) {
+        plot.removeItem(c);
+    }
+    cursors.clear();
+    for (QCPAxisRect * r : dashboard_rects) {
+        plot.plotLayout()->remove(r);
+    }
+    plot.plotLayout()->simplify();
+    dashboard_rects.clear();
+    delete dashboard_margins; // detaches from the axis rects
+    dashboard_margins = nullptr;
+    for (observable * o : dashboard) {
+        o->rect = nullptr;
+    }
+}
+
+// moves the crosshair to the data point nearest on screen to pos, returns whether the plot has to be replotted
+bool main_window::update_readout(const QPoint & pos) {
+    readout_pos = pos;
+    observable * o = nullptr;
+    for (observable * ob : shown_observables()) {
+        if (ob->x_axis(plot)->axisRect()->rect().contains(pos)) {
+            o = ob;
+        }
+    }
+    QPointF snapped;
+    QString text;
+    if (!o || !o->readout(plot, pos, time_index, snapped, text)) {
+        bool shown = crosshair;
+        remove_readout();
+        return shown;
+    }
+
+    QCPAxisRect * r = o->x_axis(plot)->axisRect();
+    if (crosshair && (crosshair->clipAxisRect() != r)) {
+        remove_readout();
+    }
+    if (!crosshair) {
+        crosshair = new QCPItemStraightLine(&plot);
+        plot.addItem(crosshair);
+        for (QCPItemPosition * p : { crosshair->point1, crosshair->point2 }) {
+            p->setAxes(o->x_axis(plot), o->y_axis(plot));
+            p->setAxisRect(r);
+            p->setTypeY(QCPItemPosition::ptAxisRectRatio);
+        }
+        crosshair->setClipAxisRect(r);
+        crosshair->setPen(QPen(Qt::darkGray, 0, Qt::DotLine));
+
+        crosshair_value = new QCPItemStraightLine(&plot);
+        plot.addItem(crosshair_value);
+        for (QCPItemPosition * p : { crosshair_value->point1, crosshair_value->point2 }) {
+            p->setAxes(o->x_axis(plot), o->y_axis(plot));
+            p->setAxisRect(r);
+            p->setTypeX(QCPItemPosition::ptAxisRectRatio);
+        }
+        crosshair_value->setClipAxisRect(r);
+        crosshair_value->setPen(QPen(Qt::darkGray, 0, Qt::DotLine));
+
+        readout_label = new QCPItemText(&plot);
+        plot.addItem(readout_label);
+        readout_label->position->setAxisRect(r);
+        readout_label->position->setType(QCPItemPosition::ptAxisRectRatio);
+        readout_label->position->setCoords(0, 0);
+        readout_label->setClipAxisRect(r);
+        readout_label->setPositionAlignment(Qt::AlignLeft | Qt::AlignTop);
+        readout_label->setTextAlignment(Qt::AlignLeft);
+        readout_label->setPadding(QMargins(4, 2, 4, 2));
+        readout_label->setBrush(QBrush(QColor(255, 255, 255, 200)));
+    } else if ((crosshair->point1->coords().x() == snapped.x()) && (crosshair_value->point1->coords().y() == snapped.y()) && (readout_label->text() == text)) {
+        return false;
+    }
+    crosshair->point1->setCoords(snapped.x(), 0);
+    crosshair->point2->setCoords(snapped.x(), 1);
+    crosshair_value->point1->setCoords(0, snapped.y());
+    crosshair_value->point2->setCoords(1, snapped.y());
+    readout_label->setText(text);
+    return true;
+}
+
+void main_window::remove_readout() {
+    if (crosshair) {
+        plot.removeItem(crosshair);
+        plot.removeItem(crosshair_value);
+        plot.removeItem(readout_label);
+    }
+    crosshair = nullptr;
+    crosshair_value = nullptr;
+    readout_label = nullptr;
+}
+
+bool main_window::eventFilter(QObject * watched, QEvent * event) {
+    if ((watched == &plot) && (event->type() == QEvent::Leave) && crosshair) {
+        remove_readout();
+        plot.replot();
     }
+    return QWidget::eventFilter(watched, event);
 }
 
 #endif
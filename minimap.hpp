@@ -0,0 +1,214 @@
+#ifndef MINIMAP_HPP
+#define MINIMAP_HPP
+
+#include <QContextMenuEvent>
+#include <QMenu>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPixmap>
+#include <QScrollBar>
+#include <QStringList>
+#include <QVector>
+#include <QWidget>
+#include <algorithm>
+
+#include "event_index.hpp"
+#include "range_index.hpp"
+#include "scrollbar_preview.hpp"
+
+// overview of a time trace and its events above the time scrollbar (a click jumps there, the context menu picks one)
+class minimap : public QWidget {
+    Q_OBJECT
+
+public:
+    inline minimap(const QScrollBar * scrollbar, QWidget * parent = nullptr);
+
+    inline void set_traces(const QStringList & names, int chosen);
+    inline void set_trace(const QVector<double> & t, const range_index & index);
+    inline void set_events(const QVector<trace_event> & events);
+    inline void set_position(int m);
+    inline void set_window(int begin, int end);
+    inline void clear();
+
+signals:
+    void time_clicked(double time);
+    void trace_chosen(int i);
+
+protected:
+    inline void paintEvent(QPaintEvent * event) override;
+    inline void mousePressEvent(QMouseEvent * event) override;
+    inline void mouseMoveEvent(QMouseEvent * event) override;
+    inline void contextMenuEvent(QContextMenuEvent * event) override;
+
+private:
+    const QScrollBar * scrollbar;
+    QStringList names;
+    int chosen;
+    QVector<double> t;
+    range_index index;
+    QVector<trace_event> events;
+    int position;
+    int window_begin;
+    int window_end;
+    QPixmap trace; // of the current groove
+    bool valid;
+
+    inline QRect groove() const;
+    inline double column_time(const QRect & g, double px) const;
+    inline double time_column(const QRect & g, double time) const;
+    inline void render(const QRect & g);
+};
+
+minimap::minimap(const QScrollBar * scrollbar, QWidget * parent)
+    : QWidget(parent), scrollbar(scrollbar), chosen(-1), position(0), window_begin(0), window_end(-1), valid(false) {
+    setFixedHeight(24);
+}
+
+void minimap::set_traces(const QStringList & names_, int chosen_) {
+    names = names_;
+    chosen = chosen_;
+}
+
+void minimap::set_trace(const QVector<double> & t_, const range_index & index_) {
+    t = t_;
+    index = index_;
+    valid = false;
+    update();
+}
+
+void minimap::set_events(const QVector<trace_event> & events_) {
+    events = events_;
+    valid = false;
+    update();
+}
+
+void minimap::set_position(int m) {
+    if (m != position) {
+        position = m;
+        update();
+    }
+}
+
+void minimap::set_window(int begin, int end) {
+    window_begin = begin;
+    window_end = end;
+    update();
+}
+
+void minimap::clear() {
+    names.clear();
+    chosen = -1;
+    set_trace(QVector<double>(), range_index());
+    set_events(QVector<trace_event>());
+    set_window(0, -1);
+}
+
+// the part of the strip above the scrollbar's groove, in which the slider moves
+QRect minimap::groove() const {
+    QRect g = scrollbar_preview::groove(scrollbar);
+    int left = scrollbar->mapTo(window(), g.topLeft()).x() - mapTo(window(), QPoint()).x();
+    return QRect(std::max(0, left), 0, std::min(g.width(), width() - std::max(0, left)), height());
+}
+
+double minimap::column_time(const QRect & g, double px) const {
+    return t.first() + (t.last() - t.first()) * (px - g.left()) / std::max(g.width() - 1, 1);
+}
+
+double minimap::time_column(const QRect & g, double time) const {
+    return g.left() + (time - t.first()) / (t.last() - t.first()) * std::max(g.width() - 1, 1);
+}
+
+// one vertical line from the minimum to the maximum of every column, then the event ticks
+void minimap::render(const QRect & g) {
+    trace = QPixmap(size());
+    trace.fill(palette().color(QPalette::Base));
+    valid = true;
+    if ((t.size() < 2) || (index.size() != t.size()) || (g.width() < 2)) {
+        return;
+    }
+
+    QVector<QCPRange> columns(g.width());
+    QCPRange all(+1e200, -1e200);
+    int m0 = 0;
+    for (int c = 0; c < g.width(); ++c) {
+        int m1 = int(std::upper_bound(t.begin(), t.end(), column_time(g, g.left() + c + 0.5)) - t.begin()) - 1;
+        m1 = std::max(m0, std::min(m1, t.size() - 1));
+        columns[c] = index.query(m0, m1);
+        all.lower = std::min(all.lower, columns[c].lower);
+        all.upper = std::max(all.upper, columns[c].upper);
+        m0 = std::min(m1 + 1, t.size() - 1);
+    }
+    if (all.upper <= all.lower) {
+        all.upper = all.lower + 1;
+    }
+
+    QPainter painter(&trace);
+    painter.setPen(QColor(0, 84, 159));
+    auto y = [&] (double v) {
+        return int((height() - 3) * (all.upper - v) / (all.upper - all.lower)) + 1;
+    };
+    for (int c = 0; c < g.width(); ++c) {
+        painter.drawLine(g.left() + c, y(columns[c].upper), g.left() + c, y(columns[c].lower));
+    }
+
+    painter.setPen(QColor(204, 7, 30));
+    for (const trace_event & e : events) {
+        int px = int(time_column(g, t[e.index]));
+        painter.drawLine(px, height() - 5, px, height() - 1);
+    }
+}
+
+void minimap::paintEvent(QPaintEvent * event) {
+    Q_UNUSED(event);
+    QRect g = groove();
+    if (!valid || (trace.size() != size())) {
+        render(g);
+    }
+    QPainter painter(this);
+    painter.drawPixmap(0, 0, trace);
+    if (t.size() < 2) {
+        return;
+    }
+    if ((window_begin <= window_end) && (window_end < t.size())) {
+        double a = time_column(g, t[window_begin]);
+        double b = time_column(g, t[window_end]);
+        painter.fillRect(QRectF(a, 0, std::max(b - a, 1.0), height()), QColor(97, 33, 88, 50));
+    }
+    if (position < t.size()) {
+        painter.setPen(Qt::black);
+        int px = int(time_column(g, t[position]));
+        painter.drawLine(px, 0, px, height() - 1);
+    }
+}
+
+void minimap::mousePressEvent(QMouseEvent * event) {
+    if ((event->button() == Qt::LeftButton) && (t.size() >= 2)) {
+        emit time_clicked(column_time(groove(), event->pos().x()));
+    }
+}
+
+void minimap::mouseMoveEvent(QMouseEvent * event) {
+    if ((event->buttons() & Qt::LeftButton) && (t.size() >= 2)) {
+        emit time_clicked(column_time(groove(), event->pos().x()));
+    }
+}
+
+void minimap::contextMenuEvent(QContextMenuEvent * event) {
+    if (names.isEmpty()) {
+        return;
+    }
+    QMenu menu;
+    for (int i = 0; i < names.size(); ++i) {
+        QAction * a = menu.addAction(names[i]);
+        a->setCheckable(true);
+        a->setChecked(i == chosen);
+        a->setData(i);
+    }
+    QAction * a = menu.exec(event->globalPos());
+    if (a) {
+        chosen = a->data().toInt();
+        emit trace_chosen(chosen);
+    }
+}
+
+#endif
@@ -4,12 +4,27 @@
 #include <armadillo>
 #include <QVector>
 #include <QString>
+#include <QStringList>
 #include <QTextStream>
 #include <QColor>
+#include <QImage>
+#include <QPainter>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <memory>
 
+#include "contour.hpp"
+#include "density_graph.hpp"
+#include "event_index.hpp"
+#include "frame_graph.hpp"
 #include "graph_data.hpp"
+#include "lod_pyramid.hpp"
+#include "prefetch.hpp"
 #include "qcustomplot.hpp"
+#include "quality_governor.hpp"
 
 static const QVector<QColor> RWTH_Colors = {
     {0, 84, 159},  // blau
@@ -20,35 +35,363 @@ static const QVector<QColor> RWTH_Colors = {
 
 class observable {
 public:
+    // how rescale() sets the y-axis
+    enum scale_mode {
+        scale_global,  // fixed range over all timesteps (set once in setup)
+        scale_frame,   // range of the current timestep
+        scale_window,  // range over the selected time window
+        scale_visible  // range of the data inside the visible x-interval
+    };
+
     QString title;
     QString ylabel;
 
     QVector<double> x;
     QVector<double> t;
 
-    bool logscale = false;
+    bool logscale = false; // plots the magnitude of the data, using log10 values computed once (see make_log)
 
     double global_min = +1e200;
     double global_max = -1e200;
 
+    scale_mode scaling = scale_global;
+    int window_begin = 0; // selected time window (indices into t, inclusive)
+    int window_end = -1;  // an empty window means nothing is selected
+
+    int quality = quality_governor::full; // lowered while the user interacts
+
+    QCPAxisRect * rect = nullptr; // where setup() adds the graphs, nullptr for the default axis rect of the plot
+
+    QVector<double> contour_levels; // iso-lines drawn by the x-t maps and marked on the profiles, in data units
+
     virtual inline ~observable() {
     }
 
-    virtual void setup(QCustomPlot & plot) = 0;
-    virtual void update(QCustomPlot & plot, int m = 0) = 0;
+    // The graphs and items of an observable are built once (per axis rect) and stay in the plot, hidden while the
+    // observable is not shown. setup() shows them and sets up the axes, hide() hides them, remove() deletes them.
+    inline void setup(QCustomPlot & plot);
+    inline void hide();
+    inline void remove(QCustomPlot & plot);
+    virtual bool refresh(QCustomPlot & plot, int m) = 0; // shows timestep m without replotting, false if nothing changed
+    inline void update(QCustomPlot & plot, int m = 0);
+
+    inline bool has_window() const;
+    inline void rescale(QCustomPlot & plot, int m);
+    virtual inline void reset_y_range(QCustomPlot & plot);
+    virtual inline bool range_dependent() const;
+    virtual inline void prefetch(QCustomPlot & plot, const QVector<int> & frames);
+    virtual inline void preview(QImage & image, int m) const;
+    virtual inline bool readout(const QCustomPlot & plot, const QPointF & pos, int m, QPointF & snapped, QString & text) const;
+
+    inline QCPAxis * x_axis(const QCustomPlot & plot) const;
+    inline QCPAxis * y_axis(const QCustomPlot & plot) const;
+
+protected:
+    QVector<QCPAbstractPlottable *> plottables; // owned by the plot
+    QVector<QCPAbstractItem *> items;
+    QVector<QCPAbstractPlottable *> legend_entries; // the plottables listed in the legend while shown
+    bool built = false;
+    QCPAxisRect * built_rect = nullptr;
+
+    virtual void build(QCustomPlot & plot) = 0;    // adds the graphs and items
+    virtual void activate(QCustomPlot & plot) = 0; // sets up the axes for them
+    virtual inline QCPRange y_range(const QCPRange & visible, int m) const;
+    inline QCPRange from_log(const QCPRange & r) const;
+    inline QString series_name(const QString & title) const;
+    inline static int nearest(const QVector<double> & keys, double key);
+    template <typename value_at>
+    inline static int nearest_point(const QCPAxis * key_axis, const QCPAxis * value_axis, const QVector<double> & keys, value_at value,
+                                    const QPointF & pos, double & distance);
+    inline static void preview_line(QImage & image, const QVector<double> & keys, const QVector<double> & values,
+                                    const QCPRange & key_range, const QCPRange & value_range, const QColor & color);
+    inline void own(QCPAbstractPlottable * plottable, bool in_legend);
+    inline void own(QCustomPlot & plot, QCPAbstractItem * item);
+    inline void place(QCustomPlot & plot, QCPAbstractItem * item) const;
+    inline void set_visible(bool visible);
 };
 
+void observable::setup(QCustomPlot & plot) {
+    if (built && (built_rect != rect)) {
+        remove(plot);
+    }
+    if (!built) {
+        build(plot);
+        built = true;
+        built_rect = rect;
+    }
+    activate(plot);
+    set_visible(true); // refresh() hides what the current settings don't show
+}
+
+void observable::hide() {
+    if (built) {
+        set_visible(false);
+    }
+}
+
+void observable::remove(QCustomPlot & plot) {
+    for (QCPAbstractPlottable * p : plottables) {
+        plot.removePlottable(p);
+    }
+    for (QCPAbstractItem * i : items) {
+        plot.removeItem(i);
+    }
+    plottables.clear();
+    items.clear();
+    legend_entries.clear();
+    built = false;
+}
+
+void observable::update(QCustomPlot & plot, int m) {
+    if (refresh(plot, m)) {
+        plot.replot();
+    }
+}
+
+bool observable::has_window() const {
+    return window_begin <= window_end;
+}
+
+// whether update() has to run again after the visible x-range changed
+bool observable::range_dependent() const {
+    return (scaling == scale_visible) || (scaling == scale_frame);
+}
+
+// the y-range rescale() sets for the automatic scaling modes; the global one for observables that do not rescale
+QCPRange observable::y_range(const QCPRange & visible, int m) const {
+    Q_UNUSED(visible);
+    Q_UNUSED(m);
+    return QCPRange(global_min, global_max);
+}
+
+// hint that these timesteps will be shown soon, e.g. during playback
+void observable::prefetch(QCustomPlot & plot, const QVector<int> & frames) {
+    Q_UNUSED(plot);
+    Q_UNUSED(frames);
+}
+
+// The values at the data point nearest on screen to the pixel position pos while timestep m is shown, as text for
+// the crosshair readout; snapped is the key and value of that point. False if there is nothing to read out.
+bool observable::readout(const QCustomPlot & plot, const QPointF & pos, int m, QPointF & snapped, QString & text) const {
+    Q_UNUSED(plot);
+    Q_UNUSED(pos);
+    Q_UNUSED(m);
+    Q_UNUSED(snapped);
+    Q_UNUSED(text);
+    return false;
+}
+
+// index of the element of the ordered keys nearest to key (binary search, the graphs have up to 10^6 points)
+int observable::nearest(const QVector<double> & keys, double key) {
+    int i = std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+    if (i == keys.size()) {
+        return keys.size() - 1;
+    }
+    if ((i > 0) && (key - keys[i - 1] < keys[i] - key)) {
+        --i;
+    }
+    return i;
+}
+
+// Index of the point (keys[j], value(j)) nearest to the pixel position pos, and its squared pixel distance. The
+// search starts at the nearest key and walks outwards only while the key alone is closer than the best point.
+template <typename value_at>
+int observable::nearest_point(const QCPAxis * key_axis, const QCPAxis * value_axis, const QVector<double> & keys, value_at value,
+                              const QPointF & pos, double & distance) {
+    auto squared = [&] (int j) {
+        double dx = key_axis->coordToPixel(keys[j]) - pos.x();
+        double dy = value_axis->coordToPixel(value(j)) - pos.y();
+        return dx * dx + dy * dy;
+    };
+    auto beyond = [&] (int j) {
+        double dx = key_axis->coordToPixel(keys[j]) - pos.x();
+        return dx * dx > distance;
+    };
+    int best = nearest(keys, key_axis->pixelToCoord(pos.x()));
+    distance = squared(best);
+    for (int j = best - 1; (j >= 0) && !beyond(j); --j) {
+        if (squared(j) < distance) {
+            best = j;
+            distance = squared(j);
+        }
+    }
+    for (int j = best + 1; (j < keys.size()) && !beyond(j); ++j) {
+        if (squared(j) < distance) {
+            best = j;
+            distance = squared(j);
+        }
+    }
+    return best;
+}
+
+// A thumbnail of timestep m for the hover preview of the time scrollbar, drawn without the plot: fixed ranges,
+// no axes, no antialiasing. Observables without one leave the image as it is.
+void observable::preview(QImage & image, int m) const {
+    Q_UNUSED(image);
+    Q_UNUSED(m);
+}
+
+// draws values over keys (both ordered by key) into image, reduced to the min and max of every pixel column
+void observable::preview_line(QImage & image, const QVector<double> & keys, const QVector<double> & values,
+                              const QCPRange & key_range, const QCPRange & value_range, const QColor & color) {
+    int w = image.width();
+    int h = image.height();
+    int n = std::min(keys.size(), values.size());
+    if ((n < 1) || (key_range.size() <= 0) || (value_range.size() <= 0)) {
+        return;
+    }
+    auto row = [&] (double v) {
+        return int((h - 1) * (value_range.upper - v) / value_range.size());
+    };
+
+    QPainter painter(&image);
+    painter.setPen(color);
+    int last_col = -1;
+    int last_row = 0;
+    for (int i = 0; i < n;) {
+        int col = int((w - 1) * (keys[i] - key_range.lower) / key_range.size());
+        int first = row(values[i]);
+        int lo = first;
+        int hi = first;
+        int end = first;
+        for (++i; (i < n) && (int((w - 1) * (keys[i] - key_range.lower) / key_range.size()) == col); ++i) {
+            end = row(values[i]);
+            lo = std::max(lo, end);
+            hi = std::min(hi, end);
+        }
+        if (last_col >= 0) {
+            painter.drawLine(last_col, last_row, col, first);
+        }
+        painter.drawLine(col, lo, col, hi);
+        last_col = col;
+        last_row = end;
+    }
+}
+
+QCPAxis * observable::x_axis(const QCustomPlot & plot) const {
+    return rect ? rect->axis(QCPAxis::atBottom) : plot.xAxis;
+}
+
+QCPAxis * observable::y_axis(const QCustomPlot & plot) const {
+    return rect ? rect->axis(QCPAxis::atLeft) : plot.yAxis;
+}
+
+// plottables and items created in build() have to be registered here
+void observable::own(QCPAbstractPlottable * plottable, bool in_legend) {
+    plottables.push_back(plottable);
+    if (in_legend) {
+        legend_entries.push_back(plottable);
+    } else {
+        plottable->removeFromLegend();
+    }
+}
+
+void observable::own(QCustomPlot & plot, QCPAbstractItem * item) {
+    plot.addItem(item); // plot takes ownership
+    place(plot, item);
+    items.push_back(item);
+}
+
+void observable::set_visible(bool visible) {
+    for (QCPAbstractPlottable * p : plottables) {
+        p->setVisible(visible);
+    }
+    for (QCPAbstractPlottable * p : legend_entries) {
+        if (visible) {
+            p->addToLegend();
+        } else {
+            p->removeFromLegend();
+        }
+    }
+    for (QCPAbstractItem * i : items) {
+        i->setVisible(visible);
+    }
+}
+
+// positions and clips an item in the axis rect of this observable
+void observable::place(QCustomPlot & plot, QCPAbstractItem * item) const {
+    for (QCPItemPosition * p : item->positions()) {
+        p->setAxes(x_axis(plot), y_axis(plot));
+        p->setAxisRect(x_axis(plot)->axisRect());
+    }
+    item->setClipAxisRect(x_axis(plot)->axisRect());
+}
+
+// a range of log10 values back to the range of the plot
+QCPRange observable::from_log(const QCPRange & r) const {
+    return QCPRange(std::pow(10.0, r.lower), std::pow(10.0, r.upper));
+}
+
+// logarithmic plots draw the magnitude (the labels and the readout keep the sign)
+QString observable::series_name(const QString & title) const {
+    return logscale ? "|" + title + "|" : title;
+}
+
+void observable::rescale(QCustomPlot & plot, int m) {
+    if ((scaling == scale_global) || ((scaling == scale_window) && !has_window())) {
+        return;
+    }
+
+    QCPRange r = y_range(x_axis(plot)->range(), m);
+
+    // same 5% padding as the global range, multiplicative on logarithmic axes
+    if (logscale && (r.lower > 0)) {
+        r.lower /= 1.05;
+        r.upper *= 1.05;
+    } else {
+        double delta = (r.upper > r.lower) ? (r.upper - r.lower) : std::max(std::abs(r.upper), 1e-30);
+        r.lower -= delta * 0.05;
+        r.upper += delta * 0.05;
+    }
+    y_axis(plot)->setRange(r);
+}
+
+// back to the global y-range, keeping the x-range the user zoomed to
+void observable::reset_y_range(QCustomPlot & plot) {
+    y_axis(plot)->setRange(global_min, global_max);
+}
+
 // xobservable
 // ---------------------------------------------------------------------------------------------------------------------------
 
 class xobservable : public observable {
 public:
     QVector<xgraph_data> data;
+    bool band_gap = false; // the first two series are the edges of a band, the readout adds the gap between them
+    bool show_density = true; // overlays the timesteps of the time window on the envelope
 
     inline xobservable(const QString & title, const QString & ylabel, const QVector<double> & x, const QVector<double> & t, bool logscale = false);
-    inline void setup(QCustomPlot & plot) override;
-    inline void update(QCustomPlot & plot, int m = 0) override;
+    inline bool refresh(QCustomPlot & plot, int m) override;
     inline void add_data(const xgraph_data & multigraph_data);
+    inline void prefetch(QCustomPlot & plot, const QVector<int> & frames) override;
+    inline void preview(QImage & image, int m) const override;
+    inline bool readout(const QCustomPlot & plot, const QPointF & pos, int m, QPointF & snapped, QString & text) const override;
+
+protected:
+    QVector<frame_graph *> profiles; // one graph per data entry
+    prefetcher<QVector<QPolygonF>> prepared; // pixel polylines of upcoming timesteps, built on worker threads
+    pixel_transform prepared_transform; // axes and widget size the prefetched polylines are valid for
+    QVector<QCPGraph *> envelope; // lower, upper and mean graph of each data entry
+    QVector<density_graph *> density; // all timesteps of the time window overlaid, one per data entry
+    int envelope_begin = 0; // time window the envelope graphs currently show
+    int envelope_end = -1;
+    int shown_m = -1; // timestep and settings of the last drawn frame
+    int shown_window_begin = 0;
+    int shown_window_end = -1;
+    scale_mode shown_scaling = scale_global;
+    QCPRange shown_range;
+    int shown_quality = quality_governor::full;
+    QVector<double> shown_levels;
+    bool shown_density = true;
+    contour_graph * level_lines = nullptr; // the contour levels across the profiles
+    QCPGraph * level_crossings = nullptr;  // where the iso-lines of the x-t maps cross the current timestep
+
+    inline void build(QCustomPlot & plot) override;
+    inline void activate(QCustomPlot & plot) override;
+    inline bool unchanged(const QCustomPlot & plot, int m) const;
+    inline void update_envelope();
+    inline void update_levels(int m);
+    inline QCPRange y_range(const QCPRange & visible, int m) const override;
 };
 
 xobservable::xobservable(const QString & title, const QString & ylabel, const QVector<double> & x, const QVector<double> & t, bool logscale) {
@@ -59,56 +402,350 @@ xobservable::xobservable(const QString & title, const QString & ylabel, const QV
     this->logscale = logscale;
 }
 
-void xobservable::setup(QCustomPlot & plot) {
-    static const QString xlabel = "x / nm";
+void xobservable::build(QCustomPlot & plot) {
+    QCPAxis * x_ax = x_axis(plot);
+    QCPAxis * y_ax = y_axis(plot);
 
-    plot.clearGraphs();
-    plot.clearItems();
+    profiles.clear();
+    for (int i = 0; i < data.size(); ++i) {
+        frame_graph * g = new frame_graph(x_ax, y_ax);
+        plot.addPlottable(g); // plot takes ownership
+        g->setName(series_name(data[i].title));
+        g->setPen(QPen(RWTH_Colors[i]));
+        own(g, true);
+        profiles.push_back(g);
+        if (logscale) {
+            data[i].make_log();
+            QCPRange r = from_log(data[i].log_frames.query(0, data[i].data.size() - 1));
+            global_min = std::min(global_min, r.lower / 1.05);
+            global_max = std::max(global_max, r.upper * 1.05);
+        } else {
+            global_min = (global_min < data[i].min) ? global_min : data[i].min;
+            global_max = (global_max > data[i].max) ? global_max : data[i].max;
+        }
+    }
+
+    // the envelope of the selected time window is drawn as a shaded band below the profiles, the timesteps in it as a
+    // density image on top of the band
+    if (!plot.layer("envelope")) {
+        plot.addLayer("envelope", plot.layer("main"), QCustomPlot::limBelow);
+    }
+    envelope.clear();
+    envelope_begin = 0;
+    envelope_end = -1;
+    for (int i = 0; i < data.size(); ++i) {
+        QCPGraph * lower = plot.addGraph(x_ax, y_ax);
+        QCPGraph * upper = plot.addGraph(x_ax, y_ax);
+        QCPGraph * mean = plot.addGraph(x_ax, y_ax);
+
+        QColor band = RWTH_Colors[i];
+        band.setAlpha(60);
+        lower->setPen(Qt::NoPen);
+        lower->setBrush(QBrush(band));
+        lower->setChannelFillGraph(upper);
+        upper->setPen(Qt::NoPen);
+        QPen mean_pen(RWTH_Colors[i]);
+        mean_pen.setStyle(Qt::DashLine);
+        mean->setPen(mean_pen);
+
+        for (QCPGraph * g : { lower, upper, mean }) {
+            g->setLayer("envelope");
+            own(g, false);
+            envelope.push_back(g);
+        }
+    }
+    density.clear();
+    for (int i = 0; i < data.size(); ++i) {
+        density_graph * d = new density_graph(x_ax, y_ax);
+        plot.addPlottable(d);
+        d->setPen(QPen(RWTH_Colors[i]));
+        d->setLayer("envelope"); // above the band, which is added before
+        own(d, false);
+        density.push_back(d);
+    }
+
+    level_lines = new contour_graph(x_ax, y_ax);
+    plot.addPlottable(level_lines);
+    level_lines->setPen(QPen(Qt::gray, 0, Qt::DotLine));
+    own(level_lines, false);
+    level_crossings = plot.addGraph(x_ax, y_ax);
+    level_crossings->setLineStyle(QCPGraph::lsNone);
+    level_crossings->setScatterStyle(QCPScatterStyle(QCPScatterStyle::ssCircle, Qt::black, 6));
+    own(level_crossings, false);
+}
+
+void xobservable::activate(QCustomPlot & plot) {
+    static const QString xlabel = "x / nm";
 
-    plot.xAxis->setRange(*(x.begin()), *(x.end() - 1)); // assume that x is ordered
-    plot.xAxis->setLabel(xlabel);
+    QCPAxis * x_ax = x_axis(plot);
+    QCPAxis * y_ax = y_axis(plot);
+    x_ax->setRange(*(x.begin()), *(x.end() - 1)); // assume that x is ordered
+    x_ax->setLabel(xlabel);
 
     if (logscale) {
-        plot.yAxis->setScaleType(QCPAxis::stLogarithmic);
+        y_ax->setScaleType(QCPAxis::stLogarithmic);
     } else {
-        plot.yAxis->setScaleType(QCPAxis::stLinear);
+        y_ax->setScaleType(QCPAxis::stLinear);
     }
+    y_ax->setRange(global_min, global_max);
+    y_ax->setLabel(ylabel);
 
-    for (int i = 0; i < data.size(); ++i) {
-        plot.addGraph();
-        plot.graph(i)->setName(data[i].title);
-        plot.graph(i)->setPen(QPen(RWTH_Colors[i]));
-        global_min = (global_min < data[i].min) ? global_min : data[i].min;
-        global_max = (global_max > data[i].max) ? global_max : data[i].max;
-    }
-    plot.yAxis->setRange(global_min, global_max);
-    plot.yAxis->setLabel(ylabel);
+    prepared.clear(); // the axes may have changed while another observable was shown
+    prepared_transform = pixel_transform();
+    shown_m = -1;
 }
 
-void xobservable::update(QCustomPlot & plot, int m) {
+bool xobservable::refresh(QCustomPlot & plot, int m) {
+    if (unchanged(plot, m)) {
+        return false; // steady state: the frame on screen already looks like timestep m
+    }
+    shown_m = m;
+    shown_window_begin = window_begin;
+    shown_window_end = window_end;
+    shown_scaling = scaling;
+    shown_range = x_axis(plot)->range();
+    shown_quality = quality;
+    shown_levels = contour_levels;
+    shown_density = show_density;
+
+    QVector<QPolygonF> lines;
+    bool ready = prepared.take(m, lines);
     for (int i = 0; i < data.size(); ++i) {
-        plot.graph(i)->setData(x, data[i].data[m]);
+        profiles[i]->set_frame(x, logscale ? data[i].log_data[m] : data[i].data[m], logscale);
+        if (ready) {
+            profiles[i]->set_polyline(prepared_transform, lines[i]); // dropped in draw() if the y-range was changed
+        }
+    }
+    for (density_graph * d : density) {
+        d->set_budget((quality >= quality_governor::coarse) ? 512 : 4096);
     }
-    plot.replot();
+    update_envelope();
+    update_levels(m);
+    rescale(plot, m);
+    return true;
 }
 
 void xobservable::add_data(const xgraph_data & multigraph_data) {
     data.push_back(multigraph_data);
 }
 
+// The polylines depend on the axis ranges and the widget size; if those changed, everything prepared so far is
+// dropped. With per-frame or visible-range scaling the y-range changes with every frame, so nothing is prepared.
+void xobservable::prefetch(QCustomPlot & plot, const QVector<int> & frames) {
+    if (range_dependent()) {
+        return;
+    }
+
+    pixel_transform transform(x_axis(plot), y_axis(plot));
+    if (!(transform == prepared_transform)) {
+        prepared_transform = transform;
+
+        QVector<double> keys = x;
+        QVector<QVector<QVector<double>>> series;
+        for (int i = 0; i < data.size(); ++i) {
+            series.push_back(logscale ? data[i].log_data : data[i].data);
+        }
+        bool log_values = logscale;
+        prepared.set_task([transform, keys, series, log_values] (int m, const std::atomic<bool> & cancel) {
+            QVector<QPolygonF> lines(series.size());
+            for (int i = 0; (i < series.size()) && !cancel; ++i) {
+                lines[i] = transform.project(keys, series[i][m], log_values);
+            }
+            return lines;
+        });
+    }
+    prepared.request(frames);
+}
+
+// the profiles of timestep m over the whole x-range, in the range of all timesteps
+void xobservable::preview(QImage & image, int m) const {
+    QCPRange r(+1e200, -1e200);
+    for (int i = 0; i < data.size(); ++i) {
+        QCPRange s = (logscale ? data[i].log_frames : data[i].frames).query(0, data[i].data.size() - 1);
+        r.lower = std::min(r.lower, s.lower);
+        r.upper = std::max(r.upper, s.upper);
+    }
+    for (int i = 0; i < data.size(); ++i) {
+        preview_line(image, x, logscale ? data[i].log_data[m] : data[i].data[m], QCPRange(x.first(), x.last()), r, RWTH_Colors[i]);
+    }
+}
+
+bool xobservable::readout(const QCustomPlot & plot, const QPointF & pos, int m, QPointF & snapped, QString & text) const {
+    if (x.isEmpty() || data.isEmpty()) {
+        return false;
+    }
+    auto plotted = [&] (int i, int j) {
+        return logscale ? std::pow(10.0, data[i].log_data[m][j]) : data[i].data[m][j];
+    };
+    int series = 0;
+    int j = 0;
+    double best = 1e200;
+    for (int i = 0; i < data.size(); ++i) {
+        double distance;
+        int k = nearest_point(x_axis(plot), y_axis(plot), x, [&] (int point) { return plotted(i, point); }, pos, distance);
+        if (distance < best) {
+            series = i;
+            j = k;
+            best = distance;
+        }
+    }
+    snapped = QPointF(x[j], plotted(series, j));
+    QStringList lines;
+    lines << "x = " + QString::number(x[j], 'g', 5) + " nm";
+    lines << data[series].title + ": " + QString::number(data[series].data[m][j], 'g', 5);
+    if (band_gap && (data.size() >= 2)) {
+        lines << "gap: " + QString::number(data[1].data[m][j] - data[0].data[m][j], 'g', 5);
+    }
+    text = lines.join("\n");
+    return true;
+}
+
+// whether the last drawn frame is visually identical to timestep m and nothing else changed since
+bool xobservable::unchanged(const QCustomPlot & plot, int m) const {
+    if ((shown_m < 0) || (window_begin != shown_window_begin) || (window_end != shown_window_end) || (scaling != shown_scaling) || (quality != shown_quality) ||
+        (x_axis(plot)->range().lower != shown_range.lower) || (x_axis(plot)->range().upper != shown_range.upper) || (contour_levels != shown_levels) ||
+        (show_density != shown_density)) {
+        return false;
+    }
+    QCPRange y = y_axis(plot)->range();
+    double displayed = logscale ? std::log10(y.upper / y.lower) : y.size();
+    for (int i = 0; i < data.size(); ++i) {
+        if (!data[i].looks_identical(m, shown_m, displayed, logscale)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void xobservable::update_envelope() {
+    for (QCPGraph * g : envelope) {
+        g->setVisible(has_window());
+    }
+    for (density_graph * d : density) {
+        d->setVisible(has_window() && show_density); // not accumulated while hidden
+    }
+    if (!has_window() || ((envelope_begin == window_begin) && (envelope_end == window_end))) {
+        return;
+    }
+    envelope_begin = window_begin;
+    envelope_end = window_end;
+
+    QVector<double> lower, upper, mean;
+    for (int i = 0; i < data.size(); ++i) {
+        if (logscale) {
+            // envelope of the log values: the mean is the geometric mean of the magnitudes
+            if (data[i].log_envelope.empty()) {
+                data[i].log_envelope = profile_index(data[i].log_data);
+            }
+            data[i].log_envelope.query(window_begin, window_end, lower, upper, mean);
+            for (QVector<double> * v : { &lower, &upper, &mean }) {
+                for (double & y : *v) {
+                    y = std::pow(10.0, y);
+                }
+            }
+        } else {
+            if (data[i].envelope.empty()) {
+                data[i].envelope = profile_index(data[i].data);
+            }
+            data[i].envelope.query(window_begin, window_end, lower, upper, mean);
+        }
+        envelope[3 * i + 0]->setData(x, lower);
+        envelope[3 * i + 1]->setData(x, upper);
+        envelope[3 * i + 2]->setData(x, mean);
+        density[i]->set_frames(x, logscale ? data[i].log_data : data[i].data, window_begin, window_end, logscale);
+    }
+}
+
+// The iso-lines of the x-t maps projected onto timestep m: a line for every level and a marker where a profile
+// crosses it. Logarithmic plots compare the magnitudes.
+void xobservable::update_levels(int m) {
+    QVector<QPolygonF> lines;
+    QVector<double> keys;
+    QVector<double> values;
+    for (double level : contour_levels) {
+        if (logscale && (level == 0)) {
+            continue;
+        }
+        double y = logscale ? std::abs(level) : level;
+        lines.push_back(QPolygonF() << QPointF(x.first(), y) << QPointF(x.last(), y));
+        for (int i = 0; i < data.size(); ++i) {
+            const QVector<double> & frame = logscale ? data[i].log_data[m] : data[i].data[m];
+            for (double c : marching_squares::crossings(x, frame, logscale ? std::log10(y) : y)) {
+                keys.push_back(c);
+                values.push_back(y);
+            }
+        }
+    }
+    level_lines->set_lines(lines);
+    level_crossings->setData(keys, values);
+}
+
+QCPRange xobservable::y_range(const QCPRange & visible, int m) const {
+    QCPRange r(+1e200, -1e200);
+    auto merge = [&r] (const QCPRange & s) {
+        r.lower = std::min(r.lower, s.lower);
+        r.upper = std::max(r.upper, s.upper);
+    };
+
+    // the visible part of one profile is short, so it is scanned directly
+    int j0 = std::lower_bound(x.begin(), x.end(), visible.lower) - x.begin();
+    int j1 = std::upper_bound(x.begin(), x.end(), visible.upper) - x.begin() - 1;
+    if ((scaling == scale_visible) && (j0 > j1)) {
+        return QCPRange(global_min, global_max);
+    }
+
+    for (int i = 0; i < data.size(); ++i) {
+        const range_index & frames = logscale ? data[i].log_frames : data[i].frames;
+        const QVector<double> & frame = logscale ? data[i].log_data[m] : data[i].data[m];
+        if (scaling == scale_window) {
+            merge(frames.query(window_begin, window_end));
+        } else if (scaling == scale_visible) {
+            auto minmax = std::minmax_element(frame.begin() + j0, frame.begin() + j1 + 1);
+            merge(QCPRange(*minmax.first, *minmax.second));
+        } else {
+            merge(frames.query(m, m));
+        }
+    }
+    return logscale ? from_log(r) : r;
+}
+
 // tobservable
 // ---------------------------------------------------------------------------------------------------------------------------
 
 class tobservable : public observable {
 public:
     QVector<tgraph_data> data;
+    QVector<trace_event> events; // filled by the background scan in main_window
+    bool derived = false; // only combines series of other tobservables (no overview traces or events of its own)
 
     inline tobservable(const QString & title, const QString & ylabel, const QVector<double> & x, const QVector<double> & t, bool logscale = false);
-    inline void setup(QCustomPlot & plot) override;
-    inline void update(QCustomPlot & plot, int m = 0) override;
+    inline bool refresh(QCustomPlot & plot, int m) override;
     inline void setup_tracer(int i);
     inline void update_tracer(int i, int m);
+    inline void update_window();
+    inline void update_markers();
     inline void add_data(const tgraph_data & graph_data);
+    inline double value(int i, int m) const;
+    inline bool range_dependent() const override;
+    inline void preview(QImage & image, int m) const override;
+    inline bool readout(const QCustomPlot & plot, const QPointF & pos, int m, QPointF & snapped, QString & text) const override;
+
+protected:
+    QVector<QCPGraph *> graphs; // one decimated graph per data entry
+    QVector<QCPGraph *> markers; // event markers, one scatter graph per data entry
+    QCPItemRect * window_rect = nullptr; // highlights the selected time window
+    QCPRange shown_range; // visible range and width the graphs were last decimated for
+    int shown_width = 0;
+    int shown_m = -1; // timestep and settings the tracers and the y-axis were last set for
+    int shown_window_begin = 0;
+    int shown_window_end = -1;
+    scale_mode shown_scaling = scale_global;
+    int shown_quality = quality_governor::full; // the tracer labels are hidden at minimal quality
+
+    inline void build(QCustomPlot & plot) override;
+    inline void activate(QCustomPlot & plot) override;
+
+    inline QCPRange y_range(const QCPRange & visible, int m) const override;
 };
 
 tobservable::tobservable(const QString & title, const QString & ylabel, const QVector<double> & x, const QVector<double> & t, bool logscale) {
@@ -119,57 +756,131 @@ tobservable::tobservable(const QString & title, const QString & ylabel, const QV
     this->logscale = logscale;
 }
 
-void tobservable::setup(QCustomPlot & plot) {
-    static const QString xlabel = "t / s";
-
-    plot.clearGraphs();
-    plot.clearItems();
-
-    plot.xAxis->setRange(*(t.begin()), *(t.end() - 1)); // assume that t is ordered
-    plot.xAxis->setLabel(xlabel);
-
-    if (logscale) {
-        plot.yAxis->setScaleType(QCPAxis::stLogarithmic);
-    } else {
-        plot.yAxis->setScaleType(QCPAxis::stLinear);
-    }
+void tobservable::build(QCustomPlot & plot) {
+    QCPAxis * x_ax = x_axis(plot);
+    QCPAxis * y_ax = y_axis(plot);
 
+    graphs.clear();
+    markers.clear();
     for (int i = 0; i < data.size(); ++i) {
         // create and customize the graph
-        plot.addGraph();
-        plot.graph(i)->setName(data[i].title);
-        plot.graph(i)->setPen(QPen(RWTH_Colors[i]));
-        global_min = (global_min < data[i].min) ? global_min : data[i].min;
-        global_max = (global_max > data[i].max) ? global_max : data[i].max;
+        QCPGraph * g = plot.addGraph(x_ax, y_ax);
+        g->setName(series_name(data[i].title));
+        g->setPen(QPen(RWTH_Colors[i]));
+        own(g, true);
+        graphs.push_back(g);
+        if (logscale) {
+            QCPRange r = from_log(data[i].log_index.query(0, data[i].data.size() - 1));
+            global_min = std::min(global_min, r.lower / 1.05);
+            global_max = std::max(global_max, r.upper * 1.05);
+        } else {
+            global_min = (global_min < data[i].min) ? global_min : data[i].min;
+            global_max = (global_max > data[i].max) ? global_max : data[i].max;
+        }
 
         // make new tracing items and let plot take ownership of them
         data[i].tracer = new QCPItemTracer(&plot);
         data[i].label  = new QCPItemText(&plot);
         data[i].arrow  = new QCPItemCurve(&plot);
-        plot.addItem(data[i].tracer);
-        plot.addItem(data[i].label);
-        plot.addItem(data[i].arrow);
-        data[i].tracer->setGraph(plot.graph(i));
+        own(plot, data[i].tracer);
+        own(plot, data[i].label);
+        own(plot, data[i].arrow);
         data[i].label->setBrush(QBrush(QColor(255,255,255,130))); //transparent white
 
         setup_tracer(i);
     }
-    plot.yAxis->setRange(global_min, global_max);
-    plot.yAxis->setLabel(ylabel);
 
+    window_rect = new QCPItemRect(&plot);
+    own(plot, window_rect);
+    window_rect->topLeft->setTypeY(QCPItemPosition::ptAxisRectRatio);
+    window_rect->bottomRight->setTypeY(QCPItemPosition::ptAxisRectRatio);
+    window_rect->setPen(Qt::NoPen);
+    window_rect->setBrush(QBrush(QColor(0, 84, 159, 40))); // transparent blue
+
+    for (int i = 0; i < data.size(); ++i) {
+        QCPGraph * g = plot.addGraph(x_ax, y_ax);
+        g->setLineStyle(QCPGraph::lsNone);
+        g->setScatterStyle(QCPScatterStyle(QCPScatterStyle::ssDiamond, RWTH_Colors[i], Qt::white, 7));
+        own(g, false);
+        markers.push_back(g);
+    }
+
+    shown_width = 0;
+}
+
+void tobservable::activate(QCustomPlot & plot) {
+    static const QString xlabel = "t / s";
+
+    QCPAxis * x_ax = x_axis(plot);
+    QCPAxis * y_ax = y_axis(plot);
+    x_ax->setRange(*(t.begin()), *(t.end() - 1)); // assume that t is ordered
+    x_ax->setLabel(xlabel);
+
+    if (logscale) {
+        y_ax->setScaleType(QCPAxis::stLogarithmic);
+    } else {
+        y_ax->setScaleType(QCPAxis::stLinear);
+    }
+    y_ax->setRange(global_min, global_max);
+    y_ax->setLabel(ylabel);
+
+    update_markers(); // the events may have arrived since the last time
+    shown_m = -1;
 }
 
-void tobservable::update(QCustomPlot & plot, int m) {
+void tobservable::update_markers() {
+    QVector<QVector<double>> event_t(data.size());
+    QVector<QVector<double>> event_y(data.size());
+    for (const trace_event & e : events) {
+        event_t[e.series].push_back(t[e.index]);
+        event_y[e.series].push_back(value(e.series, e.index));
+    }
+    for (int i = 0; i < markers.size(); ++i) {
+        markers[i]->setData(event_t[i], event_y[i]);
+    }
+}
+
+bool tobservable::refresh(QCustomPlot & plot, int m) {
+    // the graphs only hold the decimation level for the visible range, which does not depend on m
+    // (while the user interacts at low quality, a coarser level is good enough)
+    QCPRange visible = x_axis(plot)->range();
+    int width = (quality >= quality_governor::coarse) ? plot.width() / 4 : plot.width();
+    bool decimate = (visible.lower != shown_range.lower) || (visible.upper != shown_range.upper) || (width != shown_width);
+    if (!decimate && (m == shown_m) && (window_begin == shown_window_begin) && (window_end == shown_window_end) && (scaling == shown_scaling) &&
+        (quality == shown_quality)) {
+        return false;
+    }
+    shown_m = m;
+    shown_window_begin = window_begin;
+    shown_window_end = window_end;
+    shown_scaling = scaling;
+    shown_quality = quality;
+
+    if (decimate) {
+        shown_range = visible;
+        shown_width = width;
+        QVector<double> keys, values;
+        for (int i = 0; i < data.size(); ++i) {
+            data[i].levels.select(visible, width, keys, values);
+            if (logscale) {
+                for (double & v : values) {
+                    v = std::pow(10.0, v); // only the few decimated points
+                }
+            }
+            graphs[i]->setData(keys, values);
+        }
+    }
+
     for (int i = 0; i < data.size(); ++i) {
-        plot.graph(i)->setData(t, data[i].data);
         update_tracer(i, m);
     }
-    plot.replot();
+    update_window();
+    rescale(plot, m);
+    return true;
 }
 
 void tobservable::setup_tracer(int i) {
-    // setup the tracer:
-    data[i].tracer->setInterpolating(true);
+    // setup the tracer (placed on the full-resolution data point, not on the decimated graph):
     data[i].tracer->setStyle(QCPItemTracer::tsCircle);
     data[i].tracer->setPen(QPen(RWTH_Colors[i]));
     data[i].tracer->setBrush(RWTH_Colors[i]);
@@ -187,23 +898,32 @@ void tobservable::setup_tracer(int i) {
 }
 
 void tobservable::update_tracer(int i, int m) {
-    data[i].tracer->setGraphKey(t[m]);
+    double y = value(i, m); // shortcut
 
-    double y = data[i].data[m]; // shortcut
+    data[i].tracer->position->setCoords(t[m], y);
 
     QString s(data[i].title);
     QTextStream ts(&s);
     ts.setRealNumberNotation(QTextStream::SmartNotation);
     ts.setRealNumberPrecision(4);
-    ts << ":\n" << y;
+    ts << ":\n" << data[i].data[m]; // with sign, also on logarithmic plots
     data[i].label->setText(s);
+    data[i].label->setVisible(quality < quality_governor::minimal);
+    data[i].arrow->setVisible(quality < quality_governor::minimal);
 
     double width = (*(t.end() - 1) - *(t.begin()));
-    double height = (global_max - global_min);
     double labeldir_x = (m < t.size() / 2) ? 1 : -1;
-    double labeldir_y = (y < global_min + 0.5 * height) ? 1 : -1;
     double labelpos_x = t[m] + 0.1 * labeldir_x * width;
-    double labelpos_y = y + 0.1 * labeldir_y * height;
+    double labeldir_y, labelpos_y;
+    if (logscale) {
+        double height = std::log10(global_max / global_min);
+        labeldir_y = (std::log10(y / global_min) < 0.5 * height) ? 1 : -1;
+        labelpos_y = y * std::pow(10.0, 0.1 * labeldir_y * height);
+    } else {
+        double height = (global_max - global_min);
+        labeldir_y = (y < global_min + 0.5 * height) ? 1 : -1;
+        labelpos_y = y + 0.1 * labeldir_y * height;
+    }
     data[i].label->position->setCoords(labelpos_x, labelpos_y);
 
     if (labeldir_x > 0) {
@@ -223,8 +943,390 @@ void tobservable::update_tracer(int i, int m) {
     data[i].arrow->end->setCoords(7 * labeldir_x, -7 * labeldir_y);
 }
 
+void tobservable::update_window() {
+    window_rect->setVisible(has_window());
+    if (has_window()) {
+        window_rect->topLeft->setCoords(t[window_begin], 0);
+        window_rect->bottomRight->setCoords(t[window_end], 1);
+    }
+}
+
 void tobservable::add_data(const tgraph_data & graph_data) {
     data.push_back(graph_data);
+    if (logscale) {
+        data.back().make_log(); // the decimation levels hold log10 values, too
+        data.back().levels = decimation(t, data.back().log_data);
+    } else {
+        data.back().levels = decimation(t, graph_data.data);
+    }
+}
+
+// the value plotted for series i at timestep m
+double tobservable::value(int i, int m) const {
+    return logscale ? std::pow(10.0, data[i].log_data[m]) : data[i].data[m];
+}
+
+// the whole traces, from the coarsest decimation level that fills the width, and a line at timestep m
+void tobservable::preview(QImage & image, int m) const {
+    QCPRange all_t(t.first(), t.last());
+    QCPRange r(+1e200, -1e200);
+    for (int i = 0; i < data.size(); ++i) {
+        QCPRange s = (logscale ? data[i].log_index : data[i].index).query(0, data[i].data.size() - 1);
+        r.lower = std::min(r.lower, s.lower);
+        r.upper = std::max(r.upper, s.upper);
+    }
+    QVector<double> keys, values;
+    for (int i = 0; i < data.size(); ++i) {
+        data[i].levels.select(all_t, image.width(), keys, values);
+        preview_line(image, keys, values, all_t, r, RWTH_Colors[i]);
+    }
+    QPainter painter(&image);
+    painter.setPen(QPen(Qt::black, 0, Qt::DashLine));
+    int col = int((image.width() - 1) * (t[m] - all_t.lower) / all_t.size());
+    painter.drawLine(col, 0, col, image.height() - 1);
+}
+
+bool tobservable::readout(const QCustomPlot & plot, const QPointF & pos, int m, QPointF & snapped, QString & text) const {
+    Q_UNUSED(m);
+    if (t.isEmpty() || data.isEmpty()) {
+        return false;
+    }
+    int series = 0;
+    int n = 0;
+    double best = 1e200;
+    for (int i = 0; i < data.size(); ++i) {
+        double distance;
+        int k = nearest_point(x_axis(plot), y_axis(plot), t, [&] (int point) { return value(i, point); }, pos, distance);
+        if (distance < best) {
+            series = i;
+            n = k;
+            best = distance;
+        }
+    }
+    snapped = QPointF(t[n], value(series, n));
+    QStringList lines;
+    lines << "t = " + QString::number(t[n] * 1e12, 'f', 3) + " ps";
+    lines << data[series].title + ": " + QString::number(data[series].data[n], 'g', 5);
+    text = lines.join("\n");
+    return true;
+}
+
+bool tobservable::range_dependent() const {
+    return true; // the decimation level follows the visible range
+}
+
+QCPRange tobservable::y_range(const QCPRange & visible, int m) const {
+    Q_UNUSED(m);
+
+    // a single timestep has no extent of its own, so scale_frame behaves like scale_visible here
+    int i0, i1;
+    if (scaling == scale_window) {
+        i0 = window_begin;
+        i1 = window_end;
+    } else {
+        i0 = std::lower_bound(t.begin(), t.end(), visible.lower) - t.begin();
+        i1 = std::upper_bound(t.begin(), t.end(), visible.upper) - t.begin() - 1;
+        if (i0 > i1) {
+            return QCPRange(global_min, global_max);
+        }
+    }
+
+    QCPRange r(+1e200, -1e200);
+    for (int i = 0; i < data.size(); ++i) {
+        QCPRange s = logscale ? data[i].log_index.query(i0, i1) : data[i].index.query(i0, i1);
+        r.lower = std::min(r.lower, s.lower);
+        r.upper = std::max(r.upper, s.upper);
+    }
+    return logscale ? from_log(r) : r;
+}
+
+// hobservable
+// ---------------------------------------------------------------------------------------------------------------------------
+
+// one series of a spatial observable as a heatmap over time, sampled per pixel (the means of several timesteps per
+// column come from the lod_pyramid)
+class hobservable : public observable {
+public:
+    xgraph_data data; // shares the vectors of the xobservable it was made from
+    std::shared_ptr<lod_pyramid> pyramid; // of the data (the log map derives its levels), may be nullptr
+    std::shared_ptr<contour_cache> contours; // iso-lines of the data (or log_data) per level
+
+    inline hobservable(const QString & title, const QString & ylabel, const QVector<double> & x, const QVector<double> & t, const xgraph_data & data, bool logscale = false);
+    inline bool refresh(QCustomPlot & plot, int m) override;
+    inline bool range_dependent() const override;
+    inline void reset_y_range(QCustomPlot & plot) override;
+    inline void preview(QImage & image, int m) const override;
+    inline bool readout(const QCustomPlot & plot, const QPointF & pos, int m, QPointF & snapped, QString & text) const override;
+
+protected:
+    QCPColorMap * map = nullptr;
+    QCPItemStraightLine * cursor = nullptr; // the current time
+    contour_graph * iso = nullptr; // the iso-lines of contour_levels
+    QCPRange shown_t; // visible ranges, size and settings the map was last sampled for
+    QCPRange shown_x;
+    QSize shown_size;
+    scale_mode shown_scaling = scale_global;
+    int shown_window_begin = 0;
+    int shown_window_end = -1;
+    bool shown_pyramid = false;
+    QVector<double> shown_levels; // the levels iso shows, complete if all of them were extracted
+    bool shown_complete = false;
+
+    inline void build(QCustomPlot & plot) override;
+    inline void activate(QCustomPlot & plot) override;
+    inline void update_contours();
+    inline void sample(const QCPRange & visible_t, const QCPRange & visible_x, const QSize & size);
+};
+
+hobservable::hobservable(const QString & title, const QString & ylabel, const QVector<double> & x, const QVector<double> & t, const xgraph_data & data, bool logscale)
+    : data(data) {
+    this->title = title;
+    this->ylabel = ylabel;
+    this->x = x;
+    this->t = t;
+    this->logscale = logscale;
+    if (logscale) {
+        this->data.make_log(); // nothing to do if the xobservable made it already
+    }
+    contours.reset(new contour_cache(t, x, logscale ? this->data.log_data : this->data.data));
+}
+
+void hobservable::build(QCustomPlot & plot) {
+    map = new QCPColorMap(x_axis(plot), y_axis(plot));
+    plot.addPlottable(map); // plot takes ownership
+    map->setName(logscale ? "log10 " + ylabel : ylabel);
+    map->setGradient(QCPColorGradient(QCPColorGradient::gpJet));
+    map->setInterpolate(false);
+    own(map, true);
+
+    cursor = new QCPItemStraightLine(&plot);
+    own(plot, cursor);
+    cursor->point1->setTypeY(QCPItemPosition::ptAxisRectRatio);
+    cursor->point2->setTypeY(QCPItemPosition::ptAxisRectRatio);
+    cursor->setPen(QPen(Qt::white, 0, Qt::DashLine));
+
+    iso = new contour_graph(x_axis(plot), y_axis(plot));
+    plot.addPlottable(iso);
+    iso->setPen(QPen(Qt::white, 1.5));
+    own(iso, false);
+}
+
+void hobservable::activate(QCustomPlot & plot) {
+    static const QString tlabel = "t / s";
+    static const QString xlabel = "x / nm";
+
+    QCPAxis * x_ax = x_axis(plot);
+    QCPAxis * y_ax = y_axis(plot);
+    x_ax->setRange(*(t.begin()), *(t.end() - 1)); // assume that t and x are ordered
+    x_ax->setLabel(tlabel);
+    y_ax->setScaleType(QCPAxis::stLinear);
+    y_ax->setRange(*(x.begin()), *(x.end() - 1));
+    y_ax->setLabel(xlabel);
+
+    if (pyramid) {
+        pyramid->start(); // built for the maps that are shown
+    }
+    shown_size = QSize(); // sample again in refresh()
+}
+
+bool hobservable::refresh(QCustomPlot & plot, int m) {
+    cursor->point1->setCoords(t[m], 0);
+    cursor->point2->setCoords(t[m], 1);
+
+    QCPRange visible_t = x_axis(plot)->range();
+    QCPRange visible_x = y_axis(plot)->range();
+    QRect r = x_axis(plot)->axisRect()->rect();
+    int reduce = (quality >= quality_governor::coarse) ? 2 : 1;
+    QSize size(r.width() / reduce, r.height() / reduce);
+    if ((visible_t.lower != shown_t.lower) || (visible_t.upper != shown_t.upper) || (visible_x.lower != shown_x.lower) ||
+        (visible_x.upper != shown_x.upper) || (size != shown_size) || (scaling != shown_scaling) ||
+        (window_begin != shown_window_begin) || (window_end != shown_window_end) || (pyramid && (pyramid->ready() != shown_pyramid))) {
+        shown_pyramid = pyramid && pyramid->ready();
+        shown_t = visible_t;
+        shown_x = visible_x;
+        shown_size = size;
+        shown_scaling = scaling;
+        shown_window_begin = window_begin;
+        shown_window_end = window_end;
+        sample(visible_t, visible_x, size);
+    }
+    update_contours();
+    return true; // the cursor moved
+}
+
+// Levels that were not extracted yet are started here and show up with the next refresh after contours->extracted().
+// Logarithmic maps contour log10 of the magnitude.
+void hobservable::update_contours() {
+    if ((contour_levels == shown_levels) && shown_complete) {
+        return;
+    }
+    shown_levels = contour_levels;
+    shown_complete = true;
+    QVector<QPolygonF> all;
+    for (double level : contour_levels) {
+        if (logscale && (level == 0)) {
+            continue;
+        }
+        QVector<QPolygonF> lines;
+        if (contours->get(logscale ? std::log10(std::abs(level)) : level, lines)) {
+            all += lines;
+        } else {
+            shown_complete = false;
+        }
+    }
+    iso->set_lines(all);
+}
+
+bool hobservable::range_dependent() const {
+    return true; // the map is sampled for the visible ranges
+}
+
+void hobservable::reset_y_range(QCustomPlot & plot) {
+    Q_UNUSED(plot); // the y-axis shows x, the scaling only sets the color range
+}
+
+// the column of timestep m as a profile (a thumbnail of the map would not show which timestep it is)
+void hobservable::preview(QImage & image, int m) const {
+    const range_index & index = logscale ? data.log_frames : data.frames;
+    preview_line(image, x, logscale ? data.log_data[m] : data.data[m], QCPRange(x.first(), x.last()), index.query(0, index.size() - 1), RWTH_Colors[0]);
+}
+
+bool hobservable::readout(const QCustomPlot & plot, const QPointF & pos, int m, QPointF & snapped, QString & text) const {
+    Q_UNUSED(m);
+    if (t.isEmpty() || x.isEmpty()) {
+        return false;
+    }
+    int n = nearest(t, x_axis(plot)->pixelToCoord(pos.x()));
+    int j = nearest(x, y_axis(plot)->pixelToCoord(pos.y()));
+    snapped = QPointF(t[n], x[j]);
+    text = "t = " + QString::number(t[n] * 1e12, 'f', 3) + " ps\nx = " + QString::number(x[j], 'g', 5) + " nm\n" + data.title + ": " +
+           QString::number(data.data[n][j], 'g', 5);
+    return true;
+}
+
+void hobservable::sample(const QCPRange & visible_t, const QCPRange & visible_x, const QSize & size) {
+    const QVector<QVector<double>> & frames = logscale ? data.log_data : data.data;
+
+    int m0 = std::lower_bound(t.begin(), t.end(), visible_t.lower) - t.begin();
+    int m1 = std::upper_bound(t.begin(), t.end(), visible_t.upper) - t.begin() - 1;
+    int j0 = std::lower_bound(x.begin(), x.end(), visible_x.lower) - x.begin();
+    int j1 = std::upper_bound(x.begin(), x.end(), visible_x.upper) - x.begin() - 1;
+    if ((m0 > m1) || (j0 > j1) || size.isEmpty()) {
+        map->data()->clear();
+        return;
+    }
+
+    // the timesteps of every column (around its center, which is on the range ends for the outer ones) and the
+    // nearest grid point of every row
+    auto nearest = [] (const QVector<double> & v, int i0, int i1, double c) {
+        int i = std::lower_bound(v.begin() + i0, v.begin() + i1 + 1, c) - v.begin();
+        if ((i > i0) && ((i > i1) || (c - v[i - 1] < v[i] - c))) {
+            --i;
+        }
+        return i;
+    };
+    int n_t = std::min(size.width(), m1 - m0 + 1);
+    int n_x = std::min(size.height(), j1 - j0 + 1);
+    QCPRange key_range(t[m0], t[m1]);
+    QCPRange value_range(x[j0], x[j1]);
+    double step = (n_t > 1) ? key_range.size() / (n_t - 1) : 0;
+    QVector<int> columns(n_t);
+    QVector<int> column_begin(n_t + 1); // column i covers the timesteps column_begin[i] ... column_begin[i + 1] - 1
+    for (int i = 0; i < n_t; ++i) {
+        columns[i] = nearest(t, m0, m1, key_range.lower + i * step);
+        column_begin[i] = std::lower_bound(t.begin() + m0, t.begin() + m1 + 1, key_range.lower + (i - 0.5) * step) - t.begin();
+    }
+    column_begin[0] = m0;
+    column_begin[n_t] = m1 + 1;
+    QVector<int> rows(n_x);
+    for (int j = 0; j < n_x; ++j) {
+        rows[j] = nearest(x, j0, j1, (n_x > 1) ? value_range.lower + j * value_range.size() / (n_x - 1) : value_range.lower);
+    }
+
+    // each column reads one frame (or a few of a level), in parallel blocks of columns; columns of fewer timesteps
+    // than a frame of the first level are sampled directly
+    const lod_pyramid * levels = (pyramid && pyramid->ready()) ? pyramid.get() : nullptr;
+    double floor = logscale ? data.log_frames.query(0, frames.size() - 1).lower : 0; // where log_magnitude puts zeros
+    auto to_log = [floor] (double v) {
+        double a = std::abs(v);
+        return (a > 0) ? std::max(std::log10(a), floor) : floor;
+    };
+    QVector<double> grid(n_t * n_x);
+    QVector<double> column_min(n_t, +1e200);
+    QVector<double> column_max(n_t, -1e200);
+    double * cells = grid.data(); // detaches here, not in the workers
+    double * lo = column_min.data();
+    double * hi = column_max.data();
+    int block = std::max(1, n_t / (4 * QThread::idealThreadCount()));
+    QVector<int> firsts;
+    for (int i = 0; i < n_t; i += block) {
+        firsts.push_back(i);
+    }
+    QtConcurrent::blockingMap(firsts, [&] (int & first) {
+        for (int i = first; i < std::min(first + block, n_t); ++i) {
+            int begin = column_begin[i];
+            int end = std::max(column_begin[i + 1], begin + 1);
+            int k = 0;
+            while ((k < (levels ? levels->levels() : 0)) && ((2 << k) <= end - begin)) {
+                ++k;
+            }
+            if (levels && (k < levels->first_level())) {
+                k = 0;
+            }
+            if (k == 0) {
+                const QVector<double> & frame = frames.at(columns[i]);
+                for (int j = 0; j < n_x; ++j) {
+                    double v = frame.at(rows[j]);
+                    cells[j * n_t + i] = v;
+                    lo[i] = std::min(lo[i], v);
+                    hi[i] = std::max(hi[i], v);
+                }
+                continue;
+            }
+            int f0 = begin >> k;
+            int f1 = (end - 1) >> k;
+            for (int j = 0; j < n_x; ++j) {
+                double sum = 0;
+                for (int f = f0; f <= f1; ++f) {
+                    const float * cell = levels->frame(k, f) + 3 * rows[j];
+                    double c_lo = cell[0];
+                    double c_mean = cell[1];
+                    double c_hi = cell[2];
+                    if (logscale) {
+                        // the magnitudes: the mean is approximated by the log of the mean
+                        double a = to_log(c_lo);
+                        double b = to_log(c_hi);
+                        c_lo = ((c_lo <= 0) && (c_hi >= 0)) ? floor : std::min(a, b);
+                        c_hi = std::max(a, b);
+                        c_mean = to_log(c_mean);
+                    }
+                    lo[i] = std::min(lo[i], c_lo);
+                    sum += c_mean;
+                    hi[i] = std::max(hi[i], c_hi);
+                }
+                cells[j * n_t + i] = sum / (f1 - f0 + 1);
+            }
+        }
+    });
+
+    map->data()->setSize(n_t, n_x);
+    map->data()->setRange(key_range, value_range);
+    map->data()->setCells(grid.constData());
+
+    const range_index & index = logscale ? data.log_frames : data.frames;
+    QCPRange colors;
+    if (scaling == scale_global) {
+        colors = index.query(0, frames.size() - 1);
+    } else if ((scaling == scale_window) && has_window()) {
+        colors = index.query(window_begin, window_end);
+    } else {
+        // everything visible, including the extremes hidden in the means
+        colors = QCPRange(*std::min_element(column_min.begin(), column_min.end()), *std::max_element(column_max.begin(), column_max.end()));
+    }
+    if (colors.upper <= colors.lower) {
+        colors.upper = colors.lower + std::max(std::abs(colors.lower), 1e-30);
+    }
+    map->setDataRange(colors);
 }
 
 #endif
@@ -0,0 +1,176 @@
+#ifndef PLAYBACK_HPP
+#define PLAYBACK_HPP
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+#include <algorithm>
+#include <cmath>
+
+// animates the time index at speed timesteps per second of wall clock; skipped frames fall on a power-of-two grid
+
+class playback : public QObject {
+    Q_OBJECT
+
+public:
+    inline playback(QObject * parent = nullptr);
+
+    inline bool playing() const;
+    inline int stride() const;
+
+public slots:
+    inline void play(int from, int frames);
+    inline void pause();
+    inline void seek(int m);
+    inline void set_speed(double timesteps_per_second);
+    inline void set_reverse(bool on);
+
+signals:
+    void frame(int m);                  // show timestep m (connect directly, its duration is measured)
+    void upcoming(QVector<int> frames); // timesteps that will probably be shown next
+    void fps(double achieved);          // reported about once per second
+    void finished();
+
+private slots:
+    inline void tick();
+
+private:
+    static constexpr double target_fps = 30;
+    static constexpr int lookahead = 8;
+
+    QTimer timer;
+    QElapsedTimer clock;     // since the anchor was set
+    QElapsedTimer fps_clock; // since the last fps report
+
+    int n_frames;
+    double anchor;    // timestep at clock start
+    double speed;     // timesteps per second
+    bool reverse;
+    double cost;      // moving average of the seconds needed to show one frame
+    int last;         // last shown timestep
+    int step;         // current stride
+    int shown;        // frames shown since the last fps report
+
+    inline void set_anchor(double m);
+};
+
+playback::playback(QObject * parent)
+    : QObject(parent), n_frames(0), anchor(0), speed(100), reverse(false), cost(0), last(-1), step(1), shown(0) {
+    timer.setTimerType(Qt::PreciseTimer);
+    timer.setInterval(int(1000 / target_fps));
+    QObject::connect(&timer, SIGNAL(timeout()), this, SLOT(tick()));
+}
+
+bool playback::playing() const {
+    return timer.isActive();
+}
+
+int playback::stride() const {
+    return step;
+}
+
+void playback::play(int from, int frames) {
+    n_frames = frames;
+    if (n_frames < 2) {
+        return;
+    }
+    // restart from the other end if already at the end
+    if (!reverse && (from >= n_frames - 1)) {
+        from = 0;
+    } else if (reverse && (from <= 0)) {
+        from = n_frames - 1;
+    }
+
+    last = -1;
+    shown = 0;
+    set_anchor(from);
+    fps_clock.start();
+    timer.start();
+}
+
+void playback::pause() {
+    timer.stop();
+}
+
+// the user moved the time index while playing: continue from there
+void playback::seek(int m) {
+    if (playing() && (m != last)) {
+        last = m;
+        set_anchor(m);
+    }
+}
+
+void playback::set_speed(double timesteps_per_second) {
+    if (playing() && (last >= 0)) {
+        set_anchor(last);
+    }
+    speed = timesteps_per_second;
+}
+
+void playback::set_reverse(bool on) {
+    if (playing() && (last >= 0)) {
+        set_anchor(last);
+    }
+    reverse = on;
+}
+
+void playback::tick() {
+    double direction = reverse ? -1 : 1;
+    double position = anchor + direction * speed * clock.nsecsElapsed() * 1e-9;
+
+    // timesteps passing while one frame is drawn, rounded up to a power of two
+    double per_frame = speed * std::max(1.0 / target_fps, cost);
+    step = 1;
+    while (step < per_frame) {
+        step *= 2;
+    }
+
+    // only the end in the direction of travel finishes (e.g. not the last frame when playing backwards from it)
+    int m = int(std::floor(position / step)) * step;
+    bool end = false;
+    if (m >= n_frames - 1) {
+        m = n_frames - 1;
+        end = !reverse;
+    } else if (m <= 0) {
+        m = 0;
+        end = reverse;
+    }
+
+    if (m != last) {
+        QElapsedTimer render;
+        render.start();
+        last = m;
+        emit frame(m);
+        double seconds = render.nsecsElapsed() * 1e-9;
+        cost = (shown == 0 && cost == 0) ? seconds : 0.8 * cost + 0.2 * seconds;
+        ++shown;
+
+        QVector<int> next;
+        for (int k = 1; k <= lookahead; ++k) {
+            int n = m + int(direction) * k * step;
+            if ((n >= 0) && (n < n_frames)) {
+                next.push_back(n);
+            }
+        }
+        emit upcoming(next);
+    }
+
+    if (fps_clock.elapsed() >= 1000) {
+        emit fps(shown * 1000.0 / fps_clock.elapsed());
+        shown = 0;
+        fps_clock.restart();
+    }
+
+    if (end) {
+        pause();
+        emit finished();
+    }
+}
+
+void playback::set_anchor(double m) {
+    anchor = m;
+    clock.start();
+}
+
+#endif
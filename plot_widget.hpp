@@ -0,0 +1,495 @@
+#ifndef PLOT_WIDGET_HPP
+#define PLOT_WIDGET_HPP
+
+#include <QByteArray>
+#include <QCache>
+#include <QImage>
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QPixmap>
+#include <QRegion>
+#include <QResizeEvent>
+#include <QString>
+#include <QTextStream>
+#include <QTimer>
+#include <QtGlobal>
+
+#include "qcustomplot.hpp"
+#include "render_thread.hpp"
+
+// frame_key identifies a rendered frame: what is shown (observable and timestep) and how (axis ranges and size).
+// Everything else that changes the picture (time window, scaling, event markers, ...) has to clear the cache.
+class frame_key {
+public:
+    int content = -1;
+    int m = -1;
+    double x_lower = 0;
+    double x_upper = 0;
+    double y_lower = 0;
+    double y_upper = 0;
+    int width = 0;
+    int height = 0;
+
+    inline bool operator==(const frame_key & other) const;
+};
+
+bool frame_key::operator==(const frame_key & other) const {
+    return (content == other.content) && (m == other.m) && (x_lower == other.x_lower) && (x_upper == other.x_upper) &&
+           (y_lower == other.y_lower) && (y_upper == other.y_upper) && (width == other.width) && (height == other.height);
+}
+
+inline uint qHash(const frame_key & key, uint seed = 0) {
+    seed = qHash(key.content, seed) ^ (qHash(key.m) * 31);
+    seed = qHash(key.x_lower, seed) ^ (qHash(key.x_upper) * 31);
+    seed = qHash(key.y_lower, seed) ^ (qHash(key.y_upper) * 31);
+    return qHash(key.width, seed) ^ (qHash(key.height) * 31);
+}
+
+// a QCustomPlot that caches the frames rendered for set_frame() (compressed, up to max_bytes), pans by shifting the
+// last image and drawing only the uncovered strips, replots once after a resize has settled, and shows a newly
+// rendered raster image between the other layers of the last replot instead of replotting them
+class plot_widget : public QCustomPlot {
+    Q_OBJECT
+
+public:
+    inline plot_widget(QWidget * parent = nullptr);
+
+    inline void set_frame(int content, int m, bool store = true);
+    inline void disarm(); // the coming replot is not the frame of set_frame
+    inline void clear_frames();
+    inline QString cache_stats() const;
+
+protected:
+    inline void draw(QCPPainter * painter) override;
+    inline void mousePressEvent(QMouseEvent * event) override;
+    inline void mouseMoveEvent(QMouseEvent * event) override;
+    inline void mouseReleaseEvent(QMouseEvent * event) override;
+    inline void paintEvent(QPaintEvent * event) override;
+    inline void resizeEvent(QResizeEvent * event) override;
+
+signals:
+    void panning(); // the ranges of a drag changed, the replot follows
+
+private slots:
+    inline void store_frame();
+    inline void resize_settled();
+    inline void composite();
+
+private:
+    class cached_frame {
+    public:
+        QByteArray bits; // qCompress'ed image data
+        QSize size;
+        QImage::Format format;
+    };
+
+    static constexpr int max_bytes = 64 << 20;
+    static constexpr int settle_ms = 150;
+
+    raster_layer * raster; // owned by the plot
+    QPixmap under;         // the layers below the raster layer in the last replot
+    QPixmap over;          // and the ones above it, on a transparent background
+    bool split;            // the last replot drew into under and over
+    QCache<frame_key, cached_frame> frames;
+    frame_key next;   // frame of the coming replot, if armed
+    bool armed;       // the coming replot shows a frame set with set_frame
+    bool storing;     // a miss of the coming replot is stored
+    bool drawn;       // the coming replot was served from the cache
+    int hits;
+    int misses;
+
+    QCPAxisRect * pan_rect; // the axis rect being dragged, or nullptr
+    QPixmap pan_image;      // its content at the start of the drag (without the legend)
+    QPoint pan_start;
+    QPoint pan_shift;       // mouse delta along the draggable directions
+    QCPRange pan_h;         // ranges of the drag axes at the start
+    QCPRange pan_v;
+    QVector<QCPRange> pan_ranges; // of all axes of pan_rect at the start, to notice rescaling during the drag
+
+    QTimer resize_timer;
+    QPixmap preview;    // the last frame before resizing started
+    QSize preview_size; // the viewport size it was drawn for
+
+    inline frame_key current_key() const;
+    inline void draw_layers(QCPPainter * painter);
+    inline void draw_composite(QCPPainter * painter);
+    inline bool in_area(QCPLayerable * child) const;
+    inline void draw_area(QCPPainter * painter, const QRect & clip);
+    inline void draw_pan(QCPPainter * painter);
+    inline QCPAxis * drag_axis(Qt::Orientation orientation) const;
+    inline static QCPRange dragged(QCPAxis * axis, const QCPRange & start, double from, double to);
+};
+
+plot_widget::plot_widget(QWidget * parent)
+    : QCustomPlot(parent), raster(new raster_layer(this)), split(false), frames(max_bytes), armed(false), storing(false), drawn(false), hits(0), misses(0), pan_rect(nullptr) {
+    QObject::connect(this, SIGNAL(afterReplot()), this, SLOT(store_frame()));
+    QObject::connect(raster, SIGNAL(ready()), this, SLOT(composite()));
+    resize_timer.setSingleShot(true);
+    resize_timer.setInterval(settle_ms);
+    QObject::connect(&resize_timer, SIGNAL(timeout()), this, SLOT(resize_settled()));
+}
+
+// the next replot shows timestep m of content (e.g. the index of the observable); frames drawn at reduced quality
+// can still be served from the cache, but should not be stored
+void plot_widget::set_frame(int content, int m, bool store) {
+    next.content = content;
+    next.m = m;
+    armed = true;
+    storing = store;
+}
+
+void plot_widget::disarm() {
+    armed = false;
+}
+
+void plot_widget::clear_frames() {
+    frames.clear();
+}
+
+QString plot_widget::cache_stats() const {
+    QString qs;
+    QTextStream qts(&qs);
+    qts.setRealNumberNotation(QTextStream::FixedNotation);
+    qts.setRealNumberPrecision(1);
+    double rate = (hits + misses > 0) ? 100.0 * hits / (hits + misses) : 0;
+    qts << "frame cache: " << frames.count() << " frames, " << frames.totalCost() / 1048576.0 << " MB, "
+        << rate << "% hits (" << hits << " of " << hits + misses << ")";
+    return qs;
+}
+
+void plot_widget::draw(QCPPainter * painter) {
+    drawn = false;
+    split = false;
+    if (pan_rect) {
+        draw_pan(painter);
+        return;
+    }
+    if (armed) {
+        cached_frame * f = frames.object(current_key());
+        if (f) {
+            QByteArray bits = qUncompress(f->bits);
+            QImage image(reinterpret_cast<const uchar *>(bits.constData()), f->size.width(), f->size.height(), f->format);
+            painter->drawImage(0, 0, image); // bits outlives image, no copy needed
+            drawn = true;
+            ++hits;
+            return;
+        }
+    }
+    if (painter->device() == &mPaintBuffer) {
+        draw_layers(painter);
+        return;
+    }
+    QCustomPlot::draw(painter); // an export
+}
+
+// QCustomPlot::draw, keeping the layers below and above the raster layer for composite()
+void plot_widget::draw_layers(QCPPainter * painter) {
+    mPlotLayout->update(QCPLayoutElement::upPreparation);
+    mPlotLayout->update(QCPLayoutElement::upMargins);
+    mPlotLayout->update(QCPLayoutElement::upLayout);
+
+    if (under.size() != mViewport.size()) {
+        under = QPixmap(mViewport.size());
+        over = QPixmap(mViewport.size());
+    }
+    under.fill(Qt::transparent);
+    over.fill(Qt::transparent);
+    {
+        QCPPainter below(&under);
+        QCPPainter above(&over);
+        for (QCPPainter * p : { &below, &above }) {
+            p->setRenderHints(painter->renderHints());
+            p->setModes(painter->modes());
+            p->translate(-mViewport.topLeft());
+        }
+        drawBackground(&below);
+        QCPPainter * target = &below;
+        for (QCPLayer * layer : mLayers) {
+            if (layer == raster->layer()) {
+                target = &above; // the graphs on the layers below have handed in their lines
+                continue;
+            }
+            for (QCPLayerable * child : layer->children()) {
+                if (child->realVisibility()) {
+                    drawLayerable(target, child);
+                }
+            }
+        }
+    }
+    draw_composite(painter);
+    split = true;
+}
+
+void plot_widget::draw_composite(QCPPainter * painter) {
+    painter->drawPixmap(mViewport.topLeft(), under);
+    for (QCPLayerable * child : raster->layer()->children()) {
+        if (child->realVisibility()) {
+            drawLayerable(painter, child);
+        }
+    }
+    painter->drawPixmap(mViewport.topLeft(), over);
+}
+
+// the render thread finished the lines of the last replot, only they are drawn again
+void plot_widget::composite() {
+    if (!split) {
+        replot(); // the last replot was served from the cache or panned
+        return;
+    }
+    mPaintBuffer.fill(mBackgroundBrush.style() == Qt::SolidPattern ? mBackgroundBrush.color() : Qt::transparent);
+    QCPPainter painter(&mPaintBuffer);
+    painter.setRenderHint(QPainter::HighQualityAntialiasing);
+    if ((mBackgroundBrush.style() != Qt::SolidPattern) && (mBackgroundBrush.style() != Qt::NoBrush)) {
+        painter.fillRect(mViewport, mBackgroundBrush);
+    }
+    draw_composite(&painter);
+    painter.end();
+    update();
+    emit afterReplot(); // stores the frame and times its delivery
+}
+
+void plot_widget::store_frame() {
+    if (armed && !drawn && raster->pending()) {
+        return; // stays armed for the replot that shows the rendered lines
+    }
+    if (armed && !drawn) {
+        ++misses;
+    }
+    if (armed && !drawn && storing) {
+        QImage image = mPaintBuffer.toImage();
+        if (image.size() != mViewport.size()) {
+            image = image.copy(mViewport); // a reused, larger buffer
+        }
+        cached_frame * f = new cached_frame;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+        f->bits = qCompress(image.constBits(), int(image.sizeInBytes()), 1);
+#else
+        f->bits = qCompress(image.constBits(), image.byteCount(), 1);
+#endif
+        f->size = image.size();
+        f->format = image.format();
+        frames.insert(current_key(), f, f->bits.size()); // takes ownership
+    }
+    armed = false;
+}
+
+// the axis ranges are read when drawing, after the observable has rescaled them
+frame_key plot_widget::current_key() const {
+    frame_key key = next;
+    key.x_lower = xAxis->range().lower;
+    key.x_upper = xAxis->range().upper;
+    key.y_lower = yAxis->range().lower;
+    key.y_upper = yAxis->range().upper;
+    key.width = mViewport.width();
+    key.height = mViewport.height();
+    return key;
+}
+
+void plot_widget::mousePressEvent(QMouseEvent * event) {
+    QCustomPlot::mousePressEvent(event); // listeners of mousePress may switch dragging off
+
+    if ((event->button() != Qt::LeftButton) || !interactions().testFlag(QCP::iRangeDrag)) {
+        return;
+    }
+    QCPLayerable * hit = layerableAt(event->pos(), false);
+    if (qobject_cast<QCPLegend *>(hit) || qobject_cast<QCPAbstractLegendItem *>(hit) || qobject_cast<QCPAbstractItem *>(hit)) {
+        return; // the press belongs to the legend or an item, not to the data
+    }
+    for (QCPAxisRect * r : axisRects()) {
+        if (r->rect().contains(event->pos())) {
+            pan_rect = r;
+            break;
+        }
+    }
+    if (!pan_rect) {
+        return;
+    }
+
+    pan_start = event->pos();
+    pan_shift = QPoint();
+    QCPAxis * h = drag_axis(Qt::Horizontal);
+    QCPAxis * v = drag_axis(Qt::Vertical);
+    pan_h = h ? h->range() : QCPRange();
+    pan_v = v ? v->range() : QCPRange();
+    pan_ranges.clear();
+    for (QCPAxis * a : pan_rect->axes()) {
+        pan_ranges.push_back(a->range());
+    }
+
+    QRect area = pan_rect->rect();
+    pan_image = QPixmap(area.size());
+    pan_image.fill(mBackgroundBrush.style() == Qt::SolidPattern ? mBackgroundBrush.color() : Qt::transparent);
+    QCPPainter painter(&pan_image);
+    painter.translate(-area.topLeft());
+    draw_area(&painter, area);
+}
+
+void plot_widget::mouseMoveEvent(QMouseEvent * event) {
+    if (!pan_rect) {
+        QCustomPlot::mouseMoveEvent(event);
+        return;
+    }
+    emit mouseMove(event);
+
+    // the same range change as in QCPAxisRect::mouseMoveEvent, but without rangeChanged signals
+    QCPAxis * h = drag_axis(Qt::Horizontal);
+    QCPAxis * v = drag_axis(Qt::Vertical);
+    pan_shift = QPoint(h ? event->pos().x() - pan_start.x() : 0, v ? event->pos().y() - pan_start.y() : 0);
+    if (h) {
+        h->blockSignals(true);
+        h->setRange(dragged(h, pan_h, pan_start.x(), event->pos().x()));
+        h->blockSignals(false);
+    }
+    if (v) {
+        v->blockSignals(true);
+        v->setRange(dragged(v, pan_v, pan_start.y(), event->pos().y()));
+        v->blockSignals(false);
+    }
+    emit panning();
+    replot();
+}
+
+void plot_widget::mouseReleaseEvent(QMouseEvent * event) {
+    if (pan_rect) {
+        // let the axes announce their final ranges now
+        QCPAxis * h = drag_axis(Qt::Horizontal);
+        QCPAxis * v = drag_axis(Qt::Vertical);
+        QCPRange final_h = h ? h->range() : QCPRange();
+        QCPRange final_v = v ? v->range() : QCPRange();
+        pan_rect = nullptr;
+        pan_image = QPixmap();
+        for (QCPAxis * axis : { h, v }) {
+            if (axis) {
+                axis->blockSignals(true);
+                axis->setRange((axis == h) ? pan_h : pan_v);
+                axis->blockSignals(false);
+                axis->setRange((axis == h) ? final_h : final_v);
+            }
+        }
+        QCustomPlot::mouseReleaseEvent(event);
+        replot();
+        return;
+    }
+    QCustomPlot::mouseReleaseEvent(event);
+}
+
+// the things drawn inside the dragged axis rect, which move with the data
+bool plot_widget::in_area(QCPLayerable * child) const {
+    if (child == pan_rect) {
+        return true; // its background
+    }
+    if (qobject_cast<QCPGrid *>(child)) {
+        QCPAxis * axis = qobject_cast<QCPAxis *>(child->parentLayerable());
+        return axis && (axis->axisRect() == pan_rect);
+    }
+    return layerableClipRect(child) == pan_rect->rect();
+}
+
+// draws the content of the dragged axis rect within clip; graphs are drawn synchronously (as for an export)
+void plot_widget::draw_area(QCPPainter * painter, const QRect & clip) {
+    bool caching = !painter->modes().testFlag(QCPPainter::pmNoCaching);
+    painter->setMode(QCPPainter::pmNoCaching, true);
+    for (QCPLayer * layer : mLayers) {
+        for (QCPLayerable * child : layer->children()) {
+            if (child->realVisibility() && in_area(child)) {
+                drawLayerable(painter, child, clip);
+            }
+        }
+    }
+    painter->setMode(QCPPainter::pmNoCaching, !caching);
+}
+
+void plot_widget::draw_pan(QCPPainter * painter) {
+    mPlotLayout->update(QCPLayoutElement::upPreparation);
+    mPlotLayout->update(QCPLayoutElement::upMargins);
+    mPlotLayout->update(QCPLayoutElement::upLayout);
+
+    // the shifted image is only valid if the axes that are not dragged kept their ranges
+    bool rescaled = false;
+    QList<QCPAxis *> axes = pan_rect->axes();
+    for (int i = 0; i < axes.size(); ++i) {
+        bool dragging = (axes[i] == drag_axis(Qt::Horizontal)) || (axes[i] == drag_axis(Qt::Vertical));
+        rescaled |= !dragging && (i < pan_ranges.size()) && (axes[i]->range() != pan_ranges[i]);
+    }
+
+    QRect area = pan_rect->rect();
+    if ((area.size() != pan_image.size()) || rescaled) {
+        QCustomPlot::draw(painter); // the margins changed (e.g. for wider tick labels) or the y-axis was rescaled
+        return;
+    }
+    drawBackground(painter);
+
+    painter->save();
+    painter->setClipRect(area);
+    painter->drawPixmap(area.topLeft() + pan_shift, pan_image);
+    painter->restore();
+
+    QRegion exposed = QRegion(area) - QRegion(area.translated(pan_shift));
+    for (const QRect & strip : exposed) {
+        draw_area(painter, strip);
+    }
+    for (QCPLayer * layer : mLayers) {
+        for (QCPLayerable * child : layer->children()) {
+            if (child->realVisibility() && !in_area(child)) {
+                drawLayerable(painter, child);
+            }
+        }
+    }
+}
+
+QCPAxis * plot_widget::drag_axis(Qt::Orientation orientation) const {
+    if (!pan_rect || !pan_rect->rangeDrag().testFlag(orientation)) {
+        return nullptr;
+    }
+    return pan_rect->rangeDragAxis(orientation);
+}
+
+QCPRange plot_widget::dragged(QCPAxis * axis, const QCPRange & start, double from, double to) {
+    QCPRange current = axis->range();
+    axis->setRange(start); // pixelToCoord at the start range
+    double a = axis->pixelToCoord(from);
+    double b = axis->pixelToCoord(to);
+    axis->setRange(current);
+    if (axis->scaleType() == QCPAxis::stLogarithmic) {
+        return QCPRange(start.lower * a / b, start.upper * a / b);
+    }
+    return QCPRange(start.lower + a - b, start.upper + a - b);
+}
+
+void plot_widget::paintEvent(QPaintEvent * event) {
+    if (preview.isNull()) {
+        QCustomPlot::paintEvent(event);
+        return;
+    }
+    QPainter painter(this);
+    painter.drawPixmap(rect(), preview, QRect(QPoint(0, 0), preview_size));
+}
+
+void plot_widget::resizeEvent(QResizeEvent * event) {
+    if (!isVisible()) {
+        QCustomPlot::resizeEvent(event); // nothing to preview yet
+        return;
+    }
+    if (preview.isNull()) {
+        preview = mPaintBuffer; // implicitly shared, the replots until the resize settles draw into a copy
+        preview_size = mViewport.size();
+    }
+    setViewport(rect());
+    resize_timer.start();
+    update();
+}
+
+void plot_widget::resize_settled() {
+    QSize buffer = mPaintBuffer.size();
+    QSize wanted = size();
+    bool too_small = (wanted.width() > buffer.width()) || (wanted.height() > buffer.height());
+    bool too_large = 4 * wanted.width() * wanted.height() < buffer.width() * buffer.height();
+    if (too_small || too_large) {
+        mPaintBuffer = QPixmap(wanted);
+    }
+    preview = QPixmap();
+    replot();
+}
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef PREFETCH_HPP
+#define PREFETCH_HPP
+
+#include <QFuture>
+#include <QMap>
+#include <QVector>
+#include <QtConcurrent/QtConcurrentRun>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+// prepares per-timestep data on the thread pool ahead of time (the task may only read what it captured by value, and
+// should return early once its cancel flag is set)
+
+template <typename T>
+class prefetcher {
+public:
+    typedef std::function<T(int, const std::atomic<bool> &)> task_t;
+
+    inline ~prefetcher();
+
+    inline void set_task(const task_t & task);
+    inline void request(const QVector<int> & frames);
+    inline bool take(int m, T & value);
+    inline void clear();
+
+private:
+    class job {
+    public:
+        QFuture<T> future;
+        std::shared_ptr<std::atomic<bool>> cancel;
+    };
+
+    task_t task;
+    QMap<int, job> pending;
+};
+
+template <typename T>
+prefetcher<T>::~prefetcher() {
+    clear();
+}
+
+template <typename T>
+void prefetcher<T>::set_task(const task_t & task_) {
+    clear();
+    task = task_;
+}
+
+// starts preparing all frames that are not pending yet and cancels the ones no longer requested
+template <typename T>
+void prefetcher<T>::request(const QVector<int> & frames) {
+    if (!task) {
+        return;
+    }
+
+    for (auto it = pending.begin(); it != pending.end();) {
+        if (frames.contains(it.key())) {
+            ++it;
+        } else {
+            *it.value().cancel = true;
+            it = pending.erase(it);
+        }
+    }
+
+    task_t f = task;
+    for (int m : frames) {
+        if (!pending.contains(m)) {
+            job j;
+            j.cancel = std::make_shared<std::atomic<bool>>(false);
+            std::shared_ptr<std::atomic<bool>> c = j.cancel;
+            j.future = QtConcurrent::run([f, m, c] () {
+                return *c ? T() : f(m, *c); // cancelled while queued
+            });
+            pending.insert(m, j);
+        }
+    }
+}
+
+// returns the prepared data of frame m if it is done; the GUI thread does not wait for it
+template <typename T>
+bool prefetcher<T>::take(int m, T & value) {
+    auto it = pending.find(m);
+    if ((it == pending.end()) || !it.value().future.isFinished()) {
+        return false;
+    }
+    value = it.value().future.result();
+    pending.erase(it);
+    return true;
+}
+
+template <typename T>
+void prefetcher<T>::clear() {
+    for (const job & j : pending) {
+        *j.cancel = true;
+    }
+    pending.clear();
+}
+
+#endif
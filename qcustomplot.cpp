@@ -25,6 +25,8 @@
 
 #include "qcustomplot.hpp"
 
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
 
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -5375,6 +5377,46 @@ double QCPAxis::coordToPixel(double value) const
   }
 }
 
+/*!
+  Transforms the \a count coordinates in \a values to pixel coordinates in place. The result is the
+  same as calling \ref coordToPixel for every element, but the case distinctions on orientation,
+  scale type and range reversal are made once for the whole array, leaving a branch-free loop over
+  contiguous memory. On linear axes the compiler can vectorize it; on logarithmic axes only if it
+  has a vectorized log (e.g. glibc's libmvec with -ffast-math), otherwise qLn is called per element.
+*/
+void QCPAxis::coordsToPixels(double *values, int count) const
+{
+  const bool horizontal = orientation() == Qt::Horizontal;
+  const double length = horizontal ? mAxisRect->width() : mAxisRect->height();
+  const double origin = horizontal ? mAxisRect->left() : mAxisRect->bottom();
+  const double direction = (horizontal ? 1 : -1)*(mRangeReversed ? -1 : 1);
+  const double begin = mRangeReversed ? mRange.upper : mRange.lower;
+
+  if (mScaleType == stLinear)
+  {
+    const double factor = direction*length/mRange.size();
+    for (int i=0; i<count; ++i)
+      values[i] = (values[i]-begin)*factor+origin;
+  } else // mScaleType == stLogarithmic
+  {
+    // invalid values are drawn outside the visible range, on the same side as in coordToPixel
+    double invalid;
+    if (horizontal)
+      invalid = (mRange.upper > 0) == !mRangeReversed ? mAxisRect->left()-200 : mAxisRect->right()+200;
+    else
+      invalid = (mRange.upper > 0) == !mRangeReversed ? mAxisRect->bottom()+200 : mAxisRect->top()-200;
+    const double factor = direction*length/qLn(mRange.upper/mRange.lower);
+    // the log is taken of every element (of 1 for the invalid ones) and the result selected afterwards, so the
+    // loop has no branch around the call and vectorizes where the compiler has a vector log:
+    for (int i=0; i<count; ++i)
+    {
+      const double ratio = values[i]/begin;
+      const double pixel = qLn(ratio > 0 ? ratio : 1.0)*factor+origin;
+      values[i] = ratio > 0 ? pixel : invalid;
+    }
+  }
+}
+
 /*!
   Returns the part of the axis that is hit by \a pos (in pixels). The return value of this function
   is independent of the user-selectable parts defined with \ref setSelectableParts. Further, this
@@ -10881,13 +10923,7 @@ void QCustomPlot::draw(QCPPainter *painter)
     foreach (QCPLayerable *child, layer->children())
     {
       if (child->realVisibility())
-      {
-        painter->save();
-        painter->setClipRect(child->clipRect().translated(0, -1));
-        child->applyDefaultAntialiasingHint(painter);
-        child->draw(painter);
-        painter->restore();
-      }
+        drawLayerable(painter, child);
     }
   }
 
@@ -10942,6 +10978,37 @@ void QCustomPlot::drawBackground(QCPPainter *painter)
   }
 }
 
+/*! \internal
+
+  Draws a single \a layerable the way \ref draw does: clipped to its clip rect and with its default
+  antialiasing hint. If \a clip is not null, drawing is further restricted to it, which allows
+  subclasses to redraw only a part of the plot.
+*/
+void QCustomPlot::drawLayerable(QCPPainter *painter, QCPLayerable *layerable, const QRect &clip)
+{
+  QRect clipRect = layerable->clipRect();
+  if (!clip.isNull())
+  {
+    clipRect &= clip;
+    if (clipRect.isEmpty())
+      return;
+  }
+  painter->save();
+  painter->setClipRect(clipRect.translated(0, -1));
+  layerable->applyDefaultAntialiasingHint(painter);
+  layerable->draw(painter);
+  painter->restore();
+}
+
+/*! \internal
+
+  Returns the rect \a layerable is clipped to when drawn.
+*/
+QRect QCustomPlot::layerableClipRect(const QCPLayerable *layerable) const
+{
+  return layerable->clipRect();
+}
+
 
 /*! \internal
 
@@ -11300,51 +11367,50 @@ void QCPColorGradient::colorize(const double *data, const QCPRange &range, QRgb
   if (mColorBufferInvalidated)
     updateColorBuffer();
 
+  // the positions are clamped as doubles before the conversion to an index, so the non-periodic
+  // loops have no branches and can be vectorized
+  const QRgb *colors = mColorBuffer.constData();
+  const double maxIndex = mLevelCount-1;
   if (!logarithmic)
   {
     const double posToIndexFactor = (mLevelCount-1)/range.size();
+    const double offset = -range.lower*posToIndexFactor;
     if (mPeriodic)
     {
       for (int i=0; i<n; ++i)
       {
-        int index = (int)((data[dataIndexFactor*i]-range.lower)*posToIndexFactor) % mLevelCount;
+        int index = (int)(data[dataIndexFactor*i]*posToIndexFactor + offset) % mLevelCount;
         if (index < 0)
           index += mLevelCount;
-        scanLine[i] = mColorBuffer.at(index);
+        scanLine[i] = colors[index];
       }
     } else
     {
       for (int i=0; i<n; ++i)
       {
-        int index = (data[dataIndexFactor*i]-range.lower)*posToIndexFactor;
-        if (index < 0)
-          index = 0;
-        else if (index >= mLevelCount)
-          index = mLevelCount-1;
-        scanLine[i] = mColorBuffer.at(index);
+        const double pos = data[dataIndexFactor*i]*posToIndexFactor + offset;
+        scanLine[i] = colors[(int)qMax(0.0, qMin(pos, maxIndex))];
       }
     }
   } else // logarithmic == true
   {
+    const double logLower = qLn(range.lower);
+    const double logToIndexFactor = (mLevelCount-1)/qLn(range.upper/range.lower);
     if (mPeriodic)
     {
       for (int i=0; i<n; ++i)
       {
-        int index = (int)(qLn(data[dataIndexFactor*i]/range.lower)/qLn(range.upper/range.lower)*(mLevelCount-1)) % mLevelCount;
+        int index = (int)((qLn(data[dataIndexFactor*i])-logLower)*logToIndexFactor) % mLevelCount;
         if (index < 0)
           index += mLevelCount;
-        scanLine[i] = mColorBuffer.at(index);
+        scanLine[i] = colors[index];
       }
     } else
     {
       for (int i=0; i<n; ++i)
       {
-        int index = qLn(data[dataIndexFactor*i]/range.lower)/qLn(range.upper/range.lower)*(mLevelCount-1);
-        if (index < 0)
-          index = 0;
-        else if (index >= mLevelCount)
-          index = mLevelCount-1;
-        scanLine[i] = mColorBuffer.at(index);
+        const double pos = (qLn(data[dataIndexFactor*i])-logLower)*logToIndexFactor;
+        scanLine[i] = colors[(int)qMax(0.0, qMin(pos, maxIndex))];
       }
     }
   }
@@ -15219,21 +15285,29 @@ void QCPGraph::getLinePlotData(QVector<QPointF> *linePixelData, QVector<QCPData>
   linePixelData->reserve(lineData.size()+2); // added 2 to reserve memory for lower/upper fill base points that might be needed for fill
   linePixelData->resize(lineData.size());
 
-  // transform lineData points to pixels:
+  // transform lineData points to pixels, in batches over contiguous key and value arrays:
+  const int count = lineData.size();
+  QVector<double> keyPixels(count), valuePixels(count);
+  const QCPData *data = lineData.constData();
+  double *keys = keyPixels.data();
+  double *values = valuePixels.data();
+  for (int i=0; i<count; ++i)
+  {
+    keys[i] = data[i].key;
+    values[i] = data[i].value;
+  }
+  keyAxis->coordsToPixels(keys, count);
+  valueAxis->coordsToPixels(values, count);
+
+  QPointF *pixels = linePixelData->data();
   if (keyAxis->orientation() == Qt::Vertical)
   {
-    for (int i=0; i<lineData.size(); ++i)
-    {
-      (*linePixelData)[i].setX(valueAxis->coordToPixel(lineData.at(i).value));
-      (*linePixelData)[i].setY(keyAxis->coordToPixel(lineData.at(i).key));
-    }
+    for (int i=0; i<count; ++i)
+      pixels[i] = QPointF(values[i], keys[i]);
   } else // key axis is horizontal
   {
-    for (int i=0; i<lineData.size(); ++i)
-    {
-      (*linePixelData)[i].setX(keyAxis->coordToPixel(lineData.at(i).key));
-      (*linePixelData)[i].setY(valueAxis->coordToPixel(lineData.at(i).value));
-    }
+    for (int i=0; i<count; ++i)
+      pixels[i] = QPointF(keys[i], values[i]);
   }
 }
 
@@ -19856,6 +19930,23 @@ void QCPColorMapData::setCell(int keyIndex, int valueIndex, double z)
   }
 }
 
+/*!
+  Sets all cells at once. \a data must hold \ref keySize * \ref valueSize values, ordered like the
+  cells internally: <tt>data[valueIndex*keySize + keyIndex]</tt>. This is much faster than calling
+  \ref setCell for every cell. The data bounds are recalculated.
+
+  \see setCell
+*/
+void QCPColorMapData::setCells(const double *data)
+{
+  if (mData && data)
+  {
+    std::copy(data, data+mKeySize*mValueSize, mData);
+    recalculateDataBounds();
+    mDataModified = true;
+  }
+}
+
 /*!
   Goes through the data and updates the buffered minimum and maximum data values.
 
@@ -20313,6 +20404,24 @@ double QCPColorMap::selectTest(const QPointF &pos, bool onlySelectable, QVariant
   return -1;
 }
 
+/*! \internal
+
+  Colorizes the lines starting at \a firstLine of a color map (one scanline of the map image per
+  line), for the parallel loop in \ref QCPColorMap::updateMapImage.
+*/
+void QCPColorMapLineBlocks::operator()(const int &firstLine) const
+{
+  const int endLine = qMin(firstLine+blockSize, lineCount);
+  for (int line=firstLine; line<endLine; ++line)
+  {
+    QRgb* pixels = reinterpret_cast<QRgb*>(image+(lineCount-1-line)*bytesPerLine); // invert scanline index because QImage counts scanlines from top, but our vertical index counts from bottom (mathematical coordinate system)
+    if (horizontal)
+      gradient->colorize(rawData+line*rowCount, range, pixels, rowCount, 1, logarithmic);
+    else
+      gradient->colorize(rawData+line, range, pixels, rowCount, lineCount, logarithmic);
+  }
+}
+
 /*! \internal
 
   Updates the internal map image buffer by going through the internal \ref QCPColorMapData and
@@ -20356,26 +20465,31 @@ void QCPColorMap::updateMapImage()
   } else if (!mUndersampledMapImage.isNull())
     mUndersampledMapImage = QImage(); // don't need oversampling mechanism anymore (map size has changed) but mUndersampledMapImage still has nonzero size, free it
 
-  const double *rawData = mMapData->mData;
-  if (keyAxis->orientation() == Qt::Horizontal)
-  {
-    const int lineCount = valueSize;
-    const int rowCount = keySize;
-    for (int line=0; line<lineCount; ++line)
-    {
-      QRgb* pixels = reinterpret_cast<QRgb*>(localMapImage->scanLine(lineCount-1-line)); // invert scanline index because QImage counts scanlines from top, but our vertical index counts from bottom (mathematical coordinate system)
-      mGradient.colorize(rawData+line*rowCount, mDataRange, pixels, rowCount, 1, mDataScaleType==QCPAxis::stLogarithmic);
-    }
-  } else // keyAxis->orientation() == Qt::Vertical
-  {
-    const int lineCount = keySize;
-    const int rowCount = valueSize;
-    for (int line=0; line<lineCount; ++line)
-    {
-      QRgb* pixels = reinterpret_cast<QRgb*>(localMapImage->scanLine(lineCount-1-line)); // invert scanline index because QImage counts scanlines from top, but our vertical index counts from bottom (mathematical coordinate system)
-      mGradient.colorize(rawData+line, mDataRange, pixels, rowCount, lineCount, mDataScaleType==QCPAxis::stLogarithmic);
-    }
-  }
+  // colorize would update the color buffer of the gradient itself, but not safely from several threads:
+  if (mGradient.mColorBufferInvalidated)
+    mGradient.updateColorBuffer();
+
+  QCPColorMapLineBlocks blocks;
+  blocks.rawData = mMapData->mData;
+  blocks.image = localMapImage->bits(); // detaches here, not in the parallel loop
+  blocks.bytesPerLine = localMapImage->bytesPerLine();
+  blocks.horizontal = keyAxis->orientation() == Qt::Horizontal;
+  blocks.lineCount = blocks.horizontal ? valueSize : keySize;
+  blocks.rowCount = blocks.horizontal ? keySize : valueSize;
+  blocks.gradient = &mGradient;
+  blocks.range = mDataRange;
+  blocks.logarithmic = mDataScaleType == QCPAxis::stLogarithmic;
+
+  // the lines are independent of each other, large maps are colorized in parallel blocks of lines:
+  const int blockCount = keySize*valueSize < 65536 ? 1 : qMin(blocks.lineCount, 4*QThread::idealThreadCount());
+  blocks.blockSize = (blocks.lineCount+blockCount-1)/blockCount;
+  QVector<int> firstLines;
+  for (int line=0; line<blocks.lineCount; line+=blocks.blockSize)
+    firstLines.append(line);
+  if (firstLines.size() > 1)
+    QtConcurrent::blockingMap(firstLines, blocks);
+  else if (!firstLines.isEmpty())
+    blocks(firstLines.first());
 
   if (keyOversamplingFactor > 1 || valueOversamplingFactor > 1)
   {
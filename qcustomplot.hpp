@@ -1210,6 +1210,7 @@ public:
   void rescale(bool onlyVisiblePlottables=false);
   double pixelToCoord(double value) const;
   double coordToPixel(double value) const;
+  void coordsToPixels(double *values, int count) const;
   SelectablePart getPartAt(const QPointF &pos) const;
   QList<QCPAbstractPlottable*> plottables() const;
   QList<QCPGraph*> graphs() const;
@@ -1889,6 +1890,8 @@ protected:
   void updateLayerIndices() const;
   QCPLayerable *layerableAt(const QPointF &pos, bool onlySelectable, QVariant *selectionDetails=0) const;
   void drawBackground(QCPPainter *painter);
+  void drawLayerable(QCPPainter *painter, QCPLayerable *layerable, const QRect &clip=QRect());
+  QRect layerableClipRect(const QCPLayerable *layerable) const;
   
   friend class QCPLegend;
   friend class QCPAxis;
@@ -1966,6 +1969,8 @@ protected:
   // non-property members:
   QVector<QRgb> mColorBuffer;
   bool mColorBufferInvalidated;
+
+  friend class QCPColorMap;
 };
 
 
@@ -3020,6 +3025,7 @@ public:
   void setValueRange(const QCPRange &valueRange);
   void setData(double key, double value, double z);
   void setCell(int keyIndex, int valueIndex, double z);
+  void setCells(const double *data);
   
   // non-property methods:
   void recalculateDataBounds();
@@ -3043,6 +3049,27 @@ protected:
 };
 
 
+/*! \internal
+
+  A block of lines to colorize in \ref QCPColorMap::updateMapImage, used as functor of the parallel
+  loop over the blocks.
+*/
+struct QCPColorMapLineBlocks
+{
+  typedef void result_type;
+  void operator()(const int &firstLine) const;
+
+  const double *rawData;
+  uchar *image;
+  int bytesPerLine;
+  bool horizontal;
+  int lineCount, rowCount, blockSize;
+  QCPColorGradient *gradient;
+  QCPRange range;
+  bool logarithmic;
+};
+
+
 class QCP_LIB_DECL QCPColorMap : public QCPAbstractPlottable
 {
   Q_OBJECT
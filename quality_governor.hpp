@@ -0,0 +1,108 @@
+#ifndef QUALITY_GOVERNOR_HPP
+#define QUALITY_GOVERNOR_HPP
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+#include <algorithm>
+
+#include "qcustomplot.hpp"
+#include "render_thread.hpp"
+
+// lowers the render quality while the user interacts and frames (from request to delivery) take over target_ms
+
+class quality_governor : public QObject {
+    Q_OBJECT
+
+public:
+    enum level_t {
+        full,            // everything
+        no_antialiasing, // no antialiasing
+        coarse,          // and fewer points per pixel
+        minimal          // and no tracer labels
+    };
+
+    inline quality_governor(QCustomPlot * plot, QObject * parent = nullptr);
+
+    inline int level() const;
+
+public slots:
+    inline void touch(); // the user did something that causes a replot
+
+signals:
+    void changed(int level);
+
+private slots:
+    inline void replot_started();
+    inline void replot_finished();
+    inline void idle();
+
+private:
+    static constexpr double target_ms = 33;
+    static constexpr int idle_ms = 300;
+
+    QCustomPlot * plot;
+    QElapsedTimer request_clock; // since the first replot of the frame that is not delivered yet
+    bool requested;
+    QTimer idle_timer;
+    double cost; // moving average of the frame latency in ms
+    int current;
+    bool active; // the user is interacting
+};
+
+quality_governor::quality_governor(QCustomPlot * plot, QObject * parent)
+    : QObject(parent), plot(plot), requested(false), cost(0), current(full), active(false) {
+    idle_timer.setSingleShot(true);
+    idle_timer.setInterval(idle_ms);
+    QObject::connect(&idle_timer, SIGNAL(timeout()), this, SLOT(idle()));
+    QObject::connect(plot, SIGNAL(beforeReplot()), this, SLOT(replot_started()));
+    QObject::connect(plot, SIGNAL(afterReplot()), this, SLOT(replot_finished()));
+}
+
+int quality_governor::level() const {
+    return current;
+}
+
+void quality_governor::touch() {
+    active = true;
+    idle_timer.start();
+}
+
+void quality_governor::replot_started() {
+    if (!requested) {
+        request_clock.start();
+        requested = true;
+    }
+}
+
+void quality_governor::replot_finished() {
+    raster_layer * raster = raster_layer::find(plot);
+    if (!requested || (raster && raster->pending())) {
+        return; // delivered by the replot after the render thread is done
+    }
+    requested = false;
+    double ms = request_clock.nsecsElapsed() * 1e-6;
+    cost = 0.5 * cost + 0.5 * ms;
+    if (!active) {
+        return;
+    }
+
+    // a gap between the thresholds, so that the level does not flip on every frame
+    if ((cost > target_ms) && (current < minimal)) {
+        ++current;
+        emit changed(current);
+    } else if ((cost < 0.4 * target_ms) && (current > full)) {
+        --current;
+        emit changed(current);
+    }
+}
+
+void quality_governor::idle() {
+    active = false;
+    if (current != full) {
+        current = full;
+        emit changed(current);
+    }
+}
+
+#endif
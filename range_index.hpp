@@ -0,0 +1,273 @@
+#ifndef RANGE_INDEX_HPP
+#define RANGE_INDEX_HPP
+
+#include <QVector>
+#include <algorithm>
+
+#include "qcustomplot.hpp"
+
+// range_index: min/max of a series over any interval [i0, i1] in constant time (sparse table over blocks, plus the
+// extrema from the block start and up to the block end of every element)
+//
+// profile_index: min/max/mean over a time window at every x (block table only, the partial blocks are scanned)
+
+class range_index {
+public:
+    inline range_index();
+    inline range_index(const QVector<double> & data);
+    inline range_index(const QVector<double> & min, const QVector<double> & max);
+
+    inline int size() const;
+    inline QCPRange query(int i0, int i1) const;
+
+private:
+    static constexpr int block = 32;
+
+    QVector<double> min; // the original series (implicitly shared, not copied)
+    QVector<double> max;
+    QVector<double> prefix_min;
+    QVector<double> prefix_max;
+    QVector<double> suffix_min;
+    QVector<double> suffix_max;
+    QVector<QVector<double>> table_min; // table_min[k][b] = minimum of blocks b ... b + 2^k - 1
+    QVector<QVector<double>> table_max;
+
+    inline void build();
+};
+
+range_index::range_index() {
+}
+
+range_index::range_index(const QVector<double> & data)
+    : min(data), max(data) {
+    build();
+}
+
+range_index::range_index(const QVector<double> & min_, const QVector<double> & max_)
+    : min(min_), max(max_) {
+    build();
+}
+
+int range_index::size() const {
+    return min.size();
+}
+
+QCPRange range_index::query(int i0, int i1) const {
+    i0 = std::max(i0, 0);
+    i1 = std::min(i1, min.size() - 1);
+    if (i0 > i1) {
+        return QCPRange(0, 0);
+    }
+
+    int b0 = i0 / block;
+    int b1 = i1 / block;
+
+    if (b0 == b1) {
+        double lo = min[i0];
+        double hi = max[i0];
+        for (int i = i0 + 1; i <= i1; ++i) {
+            lo = std::min(lo, min[i]);
+            hi = std::max(hi, max[i]);
+        }
+        return QCPRange(lo, hi);
+    }
+
+    double lo = std::min(suffix_min[i0], prefix_min[i1]);
+    double hi = std::max(suffix_max[i0], prefix_max[i1]);
+
+    // full blocks in between: two overlapping power-of-two spans cover them
+    if (b1 - b0 > 1) {
+        int l = b0 + 1;
+        int r = b1 - 1;
+        int k = 0;
+        while ((2 << k) <= r - l + 1) {
+            ++k;
+        }
+        lo = std::min(lo, std::min(table_min[k][l], table_min[k][r - (1 << k) + 1]));
+        hi = std::max(hi, std::max(table_max[k][l], table_max[k][r - (1 << k) + 1]));
+    }
+
+    return QCPRange(lo, hi);
+}
+
+void range_index::build() {
+    int n = min.size();
+    int n_blocks = (n + block - 1) / block;
+
+    prefix_min = QVector<double>(n);
+    prefix_max = QVector<double>(n);
+    suffix_min = QVector<double>(n);
+    suffix_max = QVector<double>(n);
+
+    table_min = QVector<QVector<double>>(1, QVector<double>(n_blocks));
+    table_max = QVector<QVector<double>>(1, QVector<double>(n_blocks));
+
+    for (int b = 0; b < n_blocks; ++b) {
+        int begin = b * block;
+        int end = std::min(begin + block, n);
+
+        prefix_min[begin] = min[begin];
+        prefix_max[begin] = max[begin];
+        for (int i = begin + 1; i < end; ++i) {
+            prefix_min[i] = std::min(prefix_min[i - 1], min[i]);
+            prefix_max[i] = std::max(prefix_max[i - 1], max[i]);
+        }
+
+        suffix_min[end - 1] = min[end - 1];
+        suffix_max[end - 1] = max[end - 1];
+        for (int i = end - 2; i >= begin; --i) {
+            suffix_min[i] = std::min(suffix_min[i + 1], min[i]);
+            suffix_max[i] = std::max(suffix_max[i + 1], max[i]);
+        }
+
+        table_min[0][b] = prefix_min[end - 1];
+        table_max[0][b] = prefix_max[end - 1];
+    }
+
+    for (int k = 1; (1 << k) <= n_blocks; ++k) {
+        int span = 1 << (k - 1);
+        QVector<double> lo(n_blocks - (1 << k) + 1);
+        QVector<double> hi(lo.size());
+        for (int b = 0; b < lo.size(); ++b) {
+            lo[b] = std::min(table_min[k - 1][b], table_min[k - 1][b + span]);
+            hi[b] = std::max(table_max[k - 1][b], table_max[k - 1][b + span]);
+        }
+        table_min.push_back(lo);
+        table_max.push_back(hi);
+    }
+}
+
+class profile_index {
+public:
+    inline profile_index();
+    inline profile_index(const QVector<QVector<double>> & profiles);
+
+    inline bool empty() const;
+    inline void query(int i0, int i1, QVector<double> & min, QVector<double> & max, QVector<double> & mean) const;
+
+private:
+    static constexpr int block = 32;
+
+    QVector<QVector<double>> profiles; // implicitly shared, not copied
+    QVector<QVector<QVector<double>>> table_min; // table_min[k][b] = element-wise minimum of blocks b ... b + 2^k - 1
+    QVector<QVector<QVector<double>>> table_max;
+    QVector<QVector<double>> block_sum; // block_sum[b] = element-wise sum of blocks 0 ... b - 1
+
+    inline void scan(int i0, int i1, QVector<double> & min, QVector<double> & max, QVector<double> & sum) const;
+};
+
+profile_index::profile_index() {
+}
+
+profile_index::profile_index(const QVector<QVector<double>> & profiles_)
+    : profiles(profiles_) {
+    int n = profiles.size();
+    int n_blocks = n / block; // only complete blocks, the remainder is always scanned
+    int n_x = (n > 0) ? profiles[0].size() : 0;
+
+    table_min = QVector<QVector<QVector<double>>>(1, QVector<QVector<double>>(n_blocks));
+    table_max = QVector<QVector<QVector<double>>>(1, QVector<QVector<double>>(n_blocks));
+    block_sum = QVector<QVector<double>>(n_blocks + 1, QVector<double>(n_x, 0.0));
+
+    for (int b = 0; b < n_blocks; ++b) {
+        QVector<double> sum(n_x, 0.0);
+        table_min[0][b] = profiles[b * block];
+        table_max[0][b] = profiles[b * block];
+        scan(b * block, (b + 1) * block - 1, table_min[0][b], table_max[0][b], sum);
+        for (int j = 0; j < n_x; ++j) {
+            block_sum[b + 1][j] = block_sum[b][j] + sum[j];
+        }
+    }
+
+    for (int k = 1; (1 << k) <= n_blocks; ++k) {
+        int span = 1 << (k - 1);
+        QVector<QVector<double>> lo(n_blocks - (1 << k) + 1, QVector<double>(n_x));
+        QVector<QVector<double>> hi(lo.size(), QVector<double>(n_x));
+        for (int b = 0; b < lo.size(); ++b) {
+            const double * lo0 = table_min[k - 1][b].constData();
+            const double * lo1 = table_min[k - 1][b + span].constData();
+            const double * hi0 = table_max[k - 1][b].constData();
+            const double * hi1 = table_max[k - 1][b + span].constData();
+            double * lo_b = lo[b].data();
+            double * hi_b = hi[b].data();
+            for (int j = 0; j < n_x; ++j) {
+                lo_b[j] = std::min(lo0[j], lo1[j]);
+                hi_b[j] = std::max(hi0[j], hi1[j]);
+            }
+        }
+        table_min.push_back(lo);
+        table_max.push_back(hi);
+    }
+}
+
+bool profile_index::empty() const {
+    return profiles.isEmpty();
+}
+
+void profile_index::query(int i0, int i1, QVector<double> & min, QVector<double> & max, QVector<double> & mean) const {
+    i0 = std::max(i0, 0);
+    i1 = std::min(i1, profiles.size() - 1);
+    if (i0 > i1) {
+        min.clear();
+        max.clear();
+        mean.clear();
+        return;
+    }
+
+    int n_x = profiles[i0].size();
+    min = profiles[i0];
+    max = profiles[i0];
+    mean = QVector<double>(n_x, 0.0);
+
+    // complete blocks strictly inside the window
+    int b0 = (i0 + block - 1) / block;
+    int b1 = (i1 + 1) / block - 1;
+
+    if (b0 > b1) {
+        scan(i0, i1, min, max, mean);
+    } else {
+        scan(i0, b0 * block - 1, min, max, mean);
+        scan((b1 + 1) * block, i1, min, max, mean);
+
+        int k = 0;
+        while ((2 << k) <= b1 - b0 + 1) {
+            ++k;
+        }
+        const double * lo0 = table_min[k][b0].constData();
+        const double * lo1 = table_min[k][b1 - (1 << k) + 1].constData();
+        const double * hi0 = table_max[k][b0].constData();
+        const double * hi1 = table_max[k][b1 - (1 << k) + 1].constData();
+        const double * s0 = block_sum[b0].constData();
+        const double * s1 = block_sum[b1 + 1].constData();
+        double * lo = min.data();
+        double * hi = max.data();
+        double * sum = mean.data();
+        for (int j = 0; j < n_x; ++j) {
+            lo[j] = std::min(lo[j], std::min(lo0[j], lo1[j]));
+            hi[j] = std::max(hi[j], std::max(hi0[j], hi1[j]));
+            sum[j] += s1[j] - s0[j];
+        }
+    }
+
+    double scale = 1.0 / (i1 - i0 + 1);
+    for (int j = 0; j < n_x; ++j) {
+        mean[j] *= scale;
+    }
+}
+
+void profile_index::scan(int i0, int i1, QVector<double> & min, QVector<double> & max, QVector<double> & sum) const {
+    int n_x = min.size();
+    double * lo = min.data();
+    double * hi = max.data();
+    double * s = sum.data();
+    for (int i = i0; i <= i1; ++i) {
+        const double * p = profiles[i].constData();
+        for (int j = 0; j < n_x; ++j) {
+            lo[j] = std::min(lo[j], p[j]);
+            hi[j] = std::max(hi[j], p[j]);
+            s[j] += p[j];
+        }
+    }
+}
+
+#endif
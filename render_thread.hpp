@@ -0,0 +1,232 @@
+#ifndef RENDER_THREAD_HPP
+#define RENDER_THREAD_HPP
+
+#include <QImage>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QWaitCondition>
+#include <utility>
+
+#include "qcustomplot.hpp"
+#include "tile_raster.hpp"
+
+// rasterizes raster_jobs into a back buffer and swaps it with the front buffer; only the latest job is kept
+class render_thread : public QThread {
+    Q_OBJECT
+
+public:
+    inline render_thread(QObject * parent = nullptr);
+    inline ~render_thread();
+
+    inline int submit(const raster_job & job);
+    inline QImage front(int & serial, QVector<double> & transform);
+
+signals:
+    void rendered(); // a new front buffer is ready (emitted from the render thread)
+
+protected:
+    inline void run() override;
+
+private:
+    QMutex mutex;
+    QWaitCondition wake;
+    raster_job next;
+    bool has_next;
+    bool quit;
+    int submitted;    // serial of the last submitted job
+    QImage front_buffer;
+    int front_serial; // serial of the job in front_buffer
+    QVector<double> front_transform;
+    QImage back_buffer;
+};
+
+render_thread::render_thread(QObject * parent)
+    : QThread(parent), has_next(false), quit(false), submitted(0), front_serial(0) {
+}
+
+render_thread::~render_thread() {
+    {
+        QMutexLocker lock(&mutex);
+        quit = true;
+        wake.wakeOne();
+    }
+    wait();
+}
+
+// returns the serial of the job
+int render_thread::submit(const raster_job & job) {
+    if (!isRunning()) {
+        start(QThread::LowPriority);
+    }
+    QMutexLocker lock(&mutex);
+    next = job;
+    has_next = true;
+    wake.wakeOne();
+    return ++submitted;
+}
+
+// the last completed frame (implicitly shared, the render thread detaches before drawing into it again)
+QImage render_thread::front(int & serial, QVector<double> & transform) {
+    QMutexLocker lock(&mutex);
+    serial = front_serial;
+    transform = front_transform;
+    return front_buffer;
+}
+
+void render_thread::run() {
+    forever {
+        raster_job job;
+        int serial;
+        {
+            QMutexLocker lock(&mutex);
+            while (!has_next && !quit) {
+                wake.wait(&mutex);
+            }
+            if (quit) {
+                return;
+            }
+            job = next;
+            has_next = false;
+            serial = submitted;
+        }
+
+        if (back_buffer.size() != job.size) {
+            back_buffer = QImage(job.size, QImage::Format_ARGB32_Premultiplied);
+        }
+        back_buffer.fill(Qt::transparent);
+        rasterize(back_buffer, QPoint(0, 0), job);
+
+        {
+            QMutexLocker lock(&mutex);
+            std::swap(front_buffer, back_buffer);
+            front_serial = serial;
+            front_transform = job.transform;
+        }
+        emit rendered();
+    }
+}
+
+// a layer above "main" that takes the polylines of frame_graphs, renders them on a render_thread and blits the result;
+// a finished image is announced with ready() (plot_widget composites it without a replot)
+class raster_layer : public QCPLayerable {
+    Q_OBJECT
+
+public:
+    inline raster_layer(QCustomPlot * plot);
+
+    static inline raster_layer * find(QCustomPlot * plot);
+
+    inline void add(const QPolygonF & polyline, const QPen & pen, const QRect & clip, bool antialiased);
+    inline bool pending();
+
+signals:
+    void ready(); // a new image for the submitted lines
+
+protected:
+    inline void applyDefaultAntialiasingHint(QCPPainter * painter) const override;
+    inline void draw(QCPPainter * painter) override;
+
+private slots:
+    inline void begin();
+    inline void rendered();
+
+private:
+    inline QVector<double> transform() const;
+
+    render_thread thread;
+    raster_job collected; // lines handed in during the current replot
+    raster_job submitted;
+    int submitted_serial;
+};
+
+raster_layer::raster_layer(QCustomPlot * plot)
+    : QCPLayerable(plot), submitted_serial(0) {
+    if (!plot->layer("raster")) {
+        plot->addLayer("raster", plot->layer("main"), QCustomPlot::limAbove);
+    }
+    setLayer("raster");
+    QObject::connect(plot, SIGNAL(beforeReplot()), this, SLOT(begin()));
+    QObject::connect(&thread, SIGNAL(rendered()), this, SLOT(rendered()));
+}
+
+raster_layer * raster_layer::find(QCustomPlot * plot) {
+    QCPLayer * layer = plot->layer("raster");
+    if (layer) {
+        for (QCPLayerable * l : layer->children()) {
+            if (raster_layer * r = qobject_cast<raster_layer *>(l)) {
+                return r;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void raster_layer::add(const QPolygonF & polyline, const QPen & pen, const QRect & clip, bool antialiased) {
+    collected.antialiased = antialiased;
+    collected.add(polyline, pen, clip);
+}
+
+// whether the shown frame is older than the submitted lines
+bool raster_layer::pending() {
+    int serial;
+    QVector<double> shown;
+    thread.front(serial, shown);
+    return !submitted.empty() && (serial != submitted_serial);
+}
+
+void raster_layer::applyDefaultAntialiasingHint(QCPPainter * painter) const {
+    Q_UNUSED(painter); // the image is blitted 1:1
+}
+
+void raster_layer::draw(QCPPainter * painter) {
+    if (painter->modes() & (QCPPainter::pmNoCaching | QCPPainter::pmVectorized)) {
+        return; // exports are drawn synchronously by the graphs themselves
+    }
+
+    collected.size = mParentPlot->viewport().size();
+    collected.transform = transform();
+    if (collected.empty()) {
+        submitted = collected;
+        return;
+    }
+    if (!(collected == submitted)) {
+        submitted = collected;
+        submitted_serial = thread.submit(submitted);
+    }
+
+    // the lines of an older image are only a frame behind if they were projected to the same axes; otherwise
+    // nothing is drawn until the new image is ready
+    int serial;
+    QVector<double> shown;
+    QImage image = thread.front(serial, shown);
+    if ((image.size() == collected.size) && (shown == collected.transform)) {
+        painter->drawImage(0, 0, image);
+    }
+}
+
+QVector<double> raster_layer::transform() const {
+    QVector<double> t;
+    for (QCPAxisRect * r : mParentPlot->axisRects()) {
+        t << r->left() << r->top() << r->width() << r->height();
+        for (QCPAxis * a : r->axes()) {
+            t << a->range().lower << a->range().upper << a->scaleType();
+        }
+    }
+    return t;
+}
+
+void raster_layer::begin() {
+    collected = raster_job();
+}
+
+void raster_layer::rendered() {
+    int serial;
+    QVector<double> shown;
+    thread.front(serial, shown);
+    if (serial == submitted_serial) {
+        emit ready(); // older images were superseded before they could be shown
+    }
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef SCROLLBAR_PREVIEW_HPP
+#define SCROLLBAR_PREVIEW_HPP
+
+#include <QCache>
+#include <QEvent>
+#include <QImage>
+#include <QLabel>
+#include <QMouseEvent>
+#include <QObject>
+#include <QPixmap>
+#include <QScrollBar>
+#include <QStyle>
+#include <QStyleOptionSlider>
+#include <functional>
+
+// a cached thumbnail of the value under the mouse while it hovers over a scrollbar
+class scrollbar_preview : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int width = 160;
+    static constexpr int height = 90;
+
+    inline scrollbar_preview(QScrollBar * scrollbar);
+
+    inline void set_render(const std::function<bool(QImage &, int)> & render); // draws the thumbnail of a value
+    inline void clear();
+
+    static inline QRect groove(const QScrollBar * scrollbar); // in which the slider moves
+
+protected:
+    inline bool eventFilter(QObject * watched, QEvent * event) override;
+
+private:
+    QScrollBar * scrollbar;
+    std::function<bool(QImage &, int)> render;
+    QCache<int, QPixmap> thumbnails; // per value
+    QLabel popup;
+
+    inline void show_at(const QPoint & pos);
+};
+
+scrollbar_preview::scrollbar_preview(QScrollBar * scrollbar)
+    : QObject(scrollbar), scrollbar(scrollbar), thumbnails(512), popup(nullptr, Qt::ToolTip) {
+    scrollbar->setMouseTracking(true);
+    scrollbar->installEventFilter(this);
+    popup.setFrameStyle(QFrame::Box | QFrame::Plain);
+}
+
+void scrollbar_preview::set_render(const std::function<bool(QImage &, int)> & render_) {
+    render = render_;
+    clear();
+}
+
+void scrollbar_preview::clear() {
+    thumbnails.clear();
+    popup.hide();
+}
+
+bool scrollbar_preview::eventFilter(QObject * watched, QEvent * event) {
+    if (watched == scrollbar) {
+        if ((event->type() == QEvent::MouseMove) && scrollbar->isEnabled()) {
+            show_at(static_cast<QMouseEvent *>(event)->pos());
+        } else if ((event->type() == QEvent::Leave) || (event->type() == QEvent::MouseButtonPress) || (event->type() == QEvent::Hide)) {
+            popup.hide();
+        }
+    }
+    return false;
+}
+
+QRect scrollbar_preview::groove(const QScrollBar * scrollbar) {
+    QStyleOptionSlider option;
+    option.initFrom(scrollbar);
+    option.orientation = scrollbar->orientation();
+    option.minimum = scrollbar->minimum();
+    option.maximum = scrollbar->maximum();
+    option.sliderPosition = scrollbar->sliderPosition();
+    option.sliderValue = scrollbar->value();
+    option.singleStep = scrollbar->singleStep();
+    option.pageStep = scrollbar->pageStep();
+    return scrollbar->style()->subControlRect(QStyle::CC_ScrollBar, &option, QStyle::SC_ScrollBarGroove, scrollbar);
+}
+
+void scrollbar_preview::show_at(const QPoint & pos) {
+    QRect g = groove(scrollbar);
+    if (!render || !g.contains(pos) || (g.width() < 2)) {
+        popup.hide();
+        return;
+    }
+    int value = QStyle::sliderValueFromPosition(scrollbar->minimum(), scrollbar->maximum(), pos.x() - g.left(), g.width() - 1);
+
+    QPixmap * thumbnail = thumbnails.object(value);
+    if (!thumbnail) {
+        QImage image(width, height, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::white);
+        if (!render(image, value)) {
+            popup.hide();
+            return;
+        }
+        thumbnail = new QPixmap(QPixmap::fromImage(image));
+        thumbnails.insert(value, thumbnail); // takes ownership
+    }
+    popup.setPixmap(*thumbnail);
+    popup.adjustSize();
+    QPoint above = scrollbar->mapToGlobal(QPoint(pos.x() - popup.width() / 2, -popup.height() - 4));
+    popup.move(above);
+    popup.show();
+}
+
+#endif
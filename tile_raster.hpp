@@ -0,0 +1,120 @@
+#ifndef TILE_RASTER_HPP
+#define TILE_RASTER_HPP
+
+#include <QImage>
+#include <QPainter>
+#include <QPen>
+#include <QPolygonF>
+#include <QRect>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+
+// the data lines of one frame: pixel polylines with their pens and clip rects, and the widget size
+class raster_job {
+public:
+    QSize size;
+    QRect clip;
+    bool antialiased = true;
+    QVector<double> transform; // axis rects and ranges the lines were projected with
+    QVector<QPolygonF> lines;
+    QVector<QPen> pens;
+    QVector<QRect> clips;
+
+    inline void add(const QPolygonF & line, const QPen & pen, const QRect & line_clip);
+
+    inline bool empty() const;
+    inline bool operator==(const raster_job & other) const;
+};
+
+void raster_job::add(const QPolygonF & line, const QPen & pen, const QRect & line_clip) {
+    clip = clip.isNull() ? line_clip : (clip | line_clip);
+    lines.push_back(line);
+    pens.push_back(pen);
+    clips.push_back(line_clip);
+}
+
+bool raster_job::empty() const {
+    return lines.isEmpty();
+}
+
+bool raster_job::operator==(const raster_job & other) const {
+    // cheap fields first; lines reused by frame_graph share their data and compare by pointer
+    return (size == other.size) && (clip == other.clip) && (antialiased == other.antialiased) && (transform == other.transform) &&
+           (pens == other.pens) && (clips == other.clips) && (lines == other.lines);
+}
+
+// the parts of a polyline that have a segment within [x0, x1]
+inline QVector<QPolygonF> clip_polyline(const QPolygonF & line, double x0, double x1) {
+    QVector<QPolygonF> parts;
+    if (line.size() == 1) {
+        if ((line[0].x() >= x0) && (line[0].x() <= x1)) {
+            parts.push_back(line);
+        }
+        return parts;
+    }
+
+    QPolygonF part;
+    for (int i = 0; i + 1 < line.size(); ++i) {
+        const QPointF & a = line[i];
+        const QPointF & b = line[i + 1];
+        if ((std::max(a.x(), b.x()) >= x0) && (std::min(a.x(), b.x()) <= x1)) {
+            if (part.isEmpty()) {
+                part << a;
+            }
+            part << b;
+        } else if (!part.isEmpty()) {
+            parts.push_back(part);
+            part.clear();
+        }
+    }
+    if (!part.isEmpty()) {
+        parts.push_back(part);
+    }
+    return parts;
+}
+
+// draws job into image (pixel (0, 0) at origin) in parallel vertical tiles of the lines crossing them
+inline void rasterize(QImage & image, const QPoint & origin, const raster_job & job) {
+    static constexpr int min_tile_width = 64;
+
+    QRect area = job.clip.translated(-origin) & image.rect();
+    if (area.isEmpty() || job.empty()) {
+        return;
+    }
+
+    int n_tiles = std::max(1, std::min(QThread::idealThreadCount(), area.width() / min_tile_width));
+    QVector<QRect> tiles;
+    for (int k = 0; k < n_tiles; ++k) {
+        int x0 = area.left() + k * area.width() / n_tiles;
+        int x1 = area.left() + (k + 1) * area.width() / n_tiles;
+        tiles.push_back(QRect(x0, area.top(), x1 - x0, area.height()));
+    }
+
+    uchar * bits = image.bits(); // detaches here, not in the workers
+    int bytes_per_line = image.bytesPerLine();
+    int bytes_per_pixel = image.depth() / 8;
+    QImage::Format format = image.format();
+
+    QtConcurrent::blockingMap(tiles, [&] (QRect & tile) {
+        QImage view(bits + tile.top() * bytes_per_line + tile.left() * bytes_per_pixel, tile.width(), tile.height(), bytes_per_line, format);
+        QPainter painter(&view);
+        painter.setRenderHint(QPainter::Antialiasing, job.antialiased);
+        painter.translate(-QPointF(origin + tile.topLeft()));
+        painter.setBrush(Qt::NoBrush);
+
+        double x0 = origin.x() + tile.left();
+        double x1 = origin.x() + tile.right() + 1;
+        for (int i = 0; i < job.lines.size(); ++i) {
+            double margin = std::max(job.pens[i].widthF(), 1.0) + 2;
+            painter.setPen(job.pens[i]);
+            painter.setClipRect(job.clips[i]);
+            for (const QPolygonF & part : clip_polyline(job.lines[i], x0 - margin, x1 + margin)) {
+                painter.drawPolyline(part);
+            }
+        }
+    });
+}
+
+#endif